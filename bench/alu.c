@@ -0,0 +1,64 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "space_invaders.h"
+
+// Throughput of the flag computing ALU operations: bench_alu [millions of ops]
+
+typedef void (*AluOperation)(I8080 *cpu, uint8_t value);
+
+typedef struct aluBenchmark {
+  const char *name;
+  AluOperation operation;
+} AluBenchmark;
+
+void increment(I8080 *cpu, uint8_t value) {
+  increment_register(cpu, (value & 1) ? B : C);
+}
+
+void decrement(I8080 *cpu, uint8_t value) {
+  decrement_register(cpu, (value & 1) ? D : E);
+}
+
+double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+  long operations = (argc > 1 ? atol(argv[1]) : 50) * 1000000;
+
+  AluBenchmark benchmarks[] = {
+    { "ADD", add_accumulator },
+    { "ADC", add_with_carry_accumulator },
+    { "SUB", subtract_accumulator },
+    { "SBB", subtract_with_borrow_accumulator },
+    { "ANA", and_accumulator },
+    { "XRA", exclusive_or_accumulator },
+    { "ORA", or_accumulator },
+    { "CMP", compare_accumulator },
+    { "INR", increment },
+    { "DCR", decrement },
+  };
+  int count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+  double total = 0;
+  uint8_t checksum = 0;
+  for (int i = 0; i < count; i++) {
+    I8080 cpu = { 0 };
+    double start = now();
+    for (long n = 0; n < operations; n++) {
+      benchmarks[i].operation(&cpu, (uint8_t) (n * 0x9d));
+    }
+    double seconds = now() - start;
+    total += seconds;
+    checksum ^= cpu.registers[A] ^ cpu.registers[F];
+    printf("%s %8.1f Mops/s\n", benchmarks[i].name, operations / seconds / 1e6);
+  }
+  printf("all %8.1f Mops/s (checksum %02x)\n", operations * count / total / 1e6, checksum);
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "si_api.h"
+
+// Drives the environment API the way a training loop does, through the shared
+// library only: bench_env [--envs n] [--steps n] [--frameskip n] [--threads n]
+// Random actions are stepped one environment at a time and then with
+// si_step_batch, resetting lost games. A cloned state stepped twice with the
+// same actions must score the same.
+
+static double now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static int random_action(uint32_t *seed) {
+  *seed = *seed * 1664525u + 1013904223u;
+  return (*seed >> 16) % SI_ACTION_COUNT;
+}
+
+static void report(const char *name, int envs, int steps, int frameskip, double elapsed, long score, int games) {
+  printf(
+    "%-7s %9.0f steps/s %9.0f frames/s  %ld points, %d games over\n",
+    name,
+    (double) envs * steps / elapsed,
+    (double) envs * steps * frameskip / elapsed,
+    score,
+    games
+  );
+}
+
+static bool check_clone(SiEnv *env, int frameskip) {
+  size_t size = si_clone_state(env, NULL, 0);
+  uint8_t *state = malloc(size);
+  si_clone_state(env, state, size);
+  int scores[2] = { 0 };
+  for (int run = 0; run < 2; run++) {
+    if (!si_restore_state(env, state, size)) {
+      free(state);
+      return false;
+    }
+    uint32_t seed = 1;
+    for (int step = 0; step < 500; step++) {
+      scores[run] += si_step(env, random_action(&seed), frameskip);
+    }
+  }
+  free(state);
+  return scores[0] == scores[1];
+}
+
+int main(int argc, char *argv[]) {
+  int envs = 64;
+  int steps = 500;
+  int frameskip = 4;
+  int threads = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--envs") == 0 && i + 1 < argc) {
+      envs = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+      steps = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--frameskip") == 0 && i + 1 < argc) {
+      frameskip = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else {
+      printf("Usage: %s [--envs n] [--steps n] [--frameskip n] [--threads n]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (envs <= 0 || steps <= 0 || frameskip <= 0 || threads <= 0) {
+    printf("Error: --envs, --steps, --frameskip and --threads must be positive\n");
+    return 1;
+  }
+
+  SiEnv **env = malloc(envs * sizeof(SiEnv *));
+  for (int i = 0; i < envs; i++) {
+    env[i] = si_create("roms", 0);
+    if (env[i] == NULL) {
+      printf("Error: unable to create the environment\n");
+      return 1;
+    }
+  }
+  int *actions = malloc(envs * sizeof(int));
+  int *rewards = malloc(envs * sizeof(int));
+  printf("%d environments x %d steps of %d frames, API version %d\n", envs, steps, frameskip, si_api_version());
+
+  uint32_t seed = 1;
+  long score = 0;
+  int games = 0;
+  double start = now();
+  for (int step = 0; step < steps; step++) {
+    for (int i = 0; i < envs; i++) {
+      score += si_step(env[i], random_action(&seed), frameskip);
+      if (si_game_over(env[i])) {
+        games++;
+        si_reset(env[i]);
+      }
+    }
+  }
+  report("single", envs, steps, frameskip, now() - start, score, games);
+
+  for (int i = 0; i < envs; i++) {
+    si_reset(env[i]);
+  }
+  score = 0;
+  games = 0;
+  start = now();
+  for (int step = 0; step < steps; step++) {
+    for (int i = 0; i < envs; i++) {
+      actions[i] = random_action(&seed);
+    }
+    si_step_batch(env, envs, actions, frameskip, rewards, threads);
+    for (int i = 0; i < envs; i++) {
+      score += rewards[i];
+      if (si_game_over(env[i])) {
+        games++;
+        si_reset(env[i]);
+      }
+    }
+  }
+  report("batch", envs, steps, frameskip, now() - start, score, games);
+
+  bool same = check_clone(env[0], frameskip);
+  printf("clone / restore %s\n", same ? "ok" : "MISMATCH");
+
+  for (int i = 0; i < envs; i++) {
+    si_destroy(env[i]);
+  }
+  free(env);
+  free(actions);
+  free(rewards);
+  return same ? 0 : 1;
+}
@@ -0,0 +1,410 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpm.h"
+#include "machine.h"
+#include "movie.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Interpreter throughput on fixed workloads, as JSON for comparing commits:
+// bench [--scale f] [--repeat n] [--only name] [--movie file] > results.json
+// Each workload runs a fixed amount of emulated time, so the instruction and
+// T-state counts only change when the CPU behaviour does. The best of the
+// repeats is reported. Host cycles come from perf_event_open when the kernel
+// allows it (perf_event_paranoid), else they are null. --movie adds the
+// replay of a recorded movie as one more workload.
+
+#define SYNTHETIC_T_STATES 200000000 // 100 emulated seconds at 2 MHz
+#define EXERCISER_T_STATES 400000000
+#define ATTRACT_SECONDS 60
+
+// Compiler version string, a GCC / Clang extension
+#ifdef __VERSION__
+#define COMPILER_VERSION __VERSION__
+#else
+#define COMPILER_VERSION "unknown"
+#endif
+
+// setup loads the ROM or program outside the timed run
+typedef struct workload {
+  const char *name;
+  const char *description;
+  void (*setup)(SpaceInvaders *si);
+  void (*run)(SpaceInvaders *si, double scale);
+} Workload;
+
+// Runs a loaded program for a number of T-states or until it halts
+void run_program(SpaceInvaders *si, uint64_t t_states) {
+  while (si->cycles < t_states && !si->cpu.stopped) {
+    si->cycles += run_cycles(si, CYCLES_PER_FRAME);
+  }
+}
+
+// Maps 64 KB of RAM with no devices and starts program at 0x0100
+void load_program(SpaceInvaders *si, uint8_t *program, size_t size) {
+  memory_init(&si->memory, MEMORY_BYTES, 0);
+  memset(si->memory.bytes, 0, MEMORY_BYTES);
+  ports_init(&si->ports);
+  memory_write(&si->memory, program, CPM_TPA_ADDRESS, size);
+  si->cpu.pc = CPM_TPA_ADDRESS;
+  si->cpu.sp = CPM_BDOS_ADDRESS;
+}
+
+void setup_exerciser(SpaceInvaders *si) {
+  static CpmBdos bdos;
+  cpm_load(si, &bdos, "roms/8080EXER.COM");
+  bdos.console = NULL;
+}
+
+void run_exerciser(SpaceInvaders *si, double scale) {
+  run_program(si, EXERCISER_T_STATES * scale);
+}
+
+void run_attract(SpaceInvaders *si, double scale) {
+  uint64_t frames = ATTRACT_SECONDS * FRAMES_PER_SECOND * scale;
+  while (si->frames < frames) {
+    run_frame(si);
+  }
+}
+
+void run_synthetic(SpaceInvaders *si, double scale) {
+  run_program(si, SYNTHETIC_T_STATES * scale);
+}
+
+void setup_alu(SpaceInvaders *si) {
+  uint8_t program[] = {
+    0x80,             // 0100 ADD B
+    0x89,             // 0101 ADC C
+    0x92,             // 0102 SUB D
+    0x9b,             // 0103 SBB E
+    0xa4,             // 0104 ANA H
+    0xad,             // 0105 XRA L
+    0xb0,             // 0106 ORA B
+    0xb9,             // 0107 CMP C
+    0xc6, 0x37,       // 0108 ADI 37
+    0xde, 0x11,       // 010a SBI 11
+    0xe6, 0xf7,       // 010c ANI f7
+    0x3c,             // 010e INR A
+    0x05,             // 010f DCR B
+    0x0c,             // 0110 INR C
+    0x27,             // 0111 DAA
+    0x07,             // 0112 RLC
+    0x1f,             // 0113 RAR
+    0x2f,             // 0114 CMA
+    0x09,             // 0115 DAD B
+    0xc3, 0x00, 0x01, // 0116 JMP 0100
+  };
+  load_program(si, program, sizeof(program));
+}
+
+void setup_memory(SpaceInvaders *si) {
+  uint8_t program[] = {
+    0x21, 0x00, 0x80, // 0100 LXI H,8000
+    0x11, 0x00, 0x90, // 0103 LXI D,9000
+    0x77,             // 0106 MOV M,A
+    0x7e,             // 0107 MOV A,M
+    0x23,             // 0108 INX H
+    0x12,             // 0109 STAX D
+    0x1a,             // 010a LDAX D
+    0x13,             // 010b INX D
+    0x32, 0x00, 0xa0, // 010c STA a000
+    0x3a, 0x01, 0xa0, // 010f LDA a001
+    0x22, 0x02, 0xa0, // 0112 SHLD a002
+    0x2a, 0x02, 0xa0, // 0115 LHLD a002
+    0x34,             // 0118 INR M
+    0x86,             // 0119 ADD M
+    0xc5,             // 011a PUSH B
+    0xe5,             // 011b PUSH H
+    0xe1,             // 011c POP H
+    0xc1,             // 011d POP B
+    0x36, 0x55,       // 011e MVI M,55
+    0x7c,             // 0120 MOV A,H  keep HL in 8000-8fff
+    0xe6, 0x0f,       // 0121 ANI 0f
+    0xf6, 0x80,       // 0123 ORI 80
+    0x67,             // 0125 MOV H,A
+    0x7a,             // 0126 MOV A,D  and DE in 9000-9fff
+    0xe6, 0x0f,       // 0127 ANI 0f
+    0xf6, 0x90,       // 0129 ORI 90
+    0x57,             // 012b MOV D,A
+    0xc3, 0x06, 0x01, // 012c JMP 0106
+  };
+  load_program(si, program, sizeof(program));
+}
+
+void setup_branch(SpaceInvaders *si) {
+  uint8_t program[] = {
+    0x06, 0x00,       // 0100 MVI B,00
+    0x05,             // 0102 DCR B
+    0x78,             // 0103 MOV A,B
+    0x0f,             // 0104 RRC
+    0xda, 0x0b, 0x01, // 0105 JC 010b   taken every other pass
+    0xc3, 0x0e, 0x01, // 0108 JMP 010e
+    0xcd, 0x18, 0x01, // 010b CALL 0118
+    0xe2, 0x12, 0x01, // 010e JPO 0112
+    0x00,             // 0111 NOP
+    0xc2, 0x02, 0x01, // 0112 JNZ 0102
+    0xc3, 0x02, 0x01, // 0115 JMP 0102
+    0xa7,             // 0118 ANA A
+    0xe8,             // 0119 RPE
+    0xc9,             // 011a RET
+  };
+  load_program(si, program, sizeof(program));
+}
+
+static Movie movie;
+
+// The movie's start state restores the clocks, measure counts from there
+void setup_movie(SpaceInvaders *si) {
+  program_rom(si);
+  if (!movie_replay_start(&movie, si)) {
+    exit(1);
+  }
+}
+
+void run_movie(SpaceInvaders *si, double scale) {
+  uint32_t frames = movie.count * (scale < 1 ? scale : 1);
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    movie_replay_input(&movie, si, frame);
+    run_frame(si);
+  }
+}
+
+// the movie workload is last, only run with --movie
+static Workload workloads[] = {
+  { "8080exer", "8080EXER.COM from the start", setup_exerciser, run_exerciser },
+  { "attract", "Space Invaders attract mode", program_rom, run_attract },
+  { "alu", "synthetic ALU-heavy loop", setup_alu, run_synthetic },
+  { "memory", "synthetic load/store/stack-heavy loop", setup_memory, run_synthetic },
+  { "branch", "synthetic jump/call/return-heavy loop", setup_branch, run_synthetic },
+  { "movie", NULL, setup_movie, run_movie },
+};
+
+// Host cycles and instructions of this thread, user space only
+typedef struct hostCounters {
+  int cycles;
+  int instructions;
+} HostCounters;
+
+#ifdef __linux__
+int open_counter(uint64_t config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+bool counters_open(HostCounters *counters) {
+  counters->cycles = open_counter(PERF_COUNT_HW_CPU_CYCLES);
+  counters->instructions = open_counter(PERF_COUNT_HW_INSTRUCTIONS);
+  if (counters->cycles >= 0 && counters->instructions >= 0) {
+    return true;
+  }
+  // counting needs both, close the one that opened
+  if (counters->cycles >= 0) {
+    close(counters->cycles);
+  }
+  if (counters->instructions >= 0) {
+    close(counters->instructions);
+  }
+  return false;
+}
+
+void counters_start(HostCounters *counters) {
+  ioctl(counters->cycles, PERF_EVENT_IOC_RESET, 0);
+  ioctl(counters->instructions, PERF_EVENT_IOC_RESET, 0);
+  ioctl(counters->cycles, PERF_EVENT_IOC_ENABLE, 0);
+  ioctl(counters->instructions, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+void counters_stop(HostCounters *counters, uint64_t *cycles, uint64_t *instructions) {
+  ioctl(counters->cycles, PERF_EVENT_IOC_DISABLE, 0);
+  ioctl(counters->instructions, PERF_EVENT_IOC_DISABLE, 0);
+  if (read(counters->cycles, cycles, sizeof(*cycles)) != sizeof(*cycles)) {
+    *cycles = 0;
+  }
+  if (read(counters->instructions, instructions, sizeof(*instructions)) != sizeof(*instructions)) {
+    *instructions = 0;
+  }
+}
+#else
+bool counters_open(HostCounters *counters) {
+  return false;
+}
+
+void counters_start(HostCounters *counters) {
+}
+
+void counters_stop(HostCounters *counters, uint64_t *cycles, uint64_t *instructions) {
+  *cycles = 0;
+  *instructions = 0;
+}
+#endif
+
+typedef struct result {
+  uint64_t instructions;
+  uint64_t t_states;
+  double seconds;
+  uint64_t host_cycles;
+  uint64_t host_instructions;
+} Result;
+
+Result measure(const Workload *workload, double scale, HostCounters *counters, bool counting) {
+  SpaceInvaders *si = space_invaders_new();
+  Result result = { 0 };
+  workload->setup(si);
+  uint64_t instructions = si->instructions;
+  uint64_t t_states = si->cycles;
+
+  if (counting) {
+    counters_start(counters);
+  }
+  double start = monotonic_time();
+  workload->run(si, scale);
+  result.seconds = monotonic_time() - start;
+  if (counting) {
+    counters_stop(counters, &result.host_cycles, &result.host_instructions);
+  }
+
+  result.instructions = si->instructions - instructions;
+  result.t_states = si->cycles - t_states;
+  space_invaders_free(si);
+  return result;
+}
+
+// A quoted JSON string: the movie workload's description is a user path
+void print_json_string(const char *string) {
+  putchar('"');
+  for (const unsigned char *c = (const unsigned char *) string; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      printf("\\%c", *c);
+    } else if (*c < 0x20) {
+      printf("\\u%04x", *c);
+    } else {
+      putchar(*c);
+    }
+  }
+  putchar('"');
+}
+
+// A per emulated instruction host counter, or null without perf counters
+void print_per_instruction(const char *name, uint64_t count, uint64_t instructions, bool last) {
+  if (count == 0) {
+    printf("      \"%s\": null%s\n", name, last ? "" : ",");
+  } else {
+    printf("      \"%s\": %.3f%s\n", name, (double) count / instructions, last ? "" : ",");
+  }
+}
+
+void print_result(const Workload *workload, Result *result, bool last) {
+  printf("    {\n");
+  printf("      \"name\": \"%s\",\n", workload->name);
+  printf("      \"description\": ");
+  print_json_string(workload->description);
+  printf(",\n");
+  printf("      \"instructions\": %llu,\n", (unsigned long long) result->instructions);
+  printf("      \"t_states\": %llu,\n", (unsigned long long) result->t_states);
+  printf("      \"seconds\": %.6f,\n", result->seconds);
+  printf("      \"emulated_mhz\": %.3f,\n", result->t_states / result->seconds / 1e6);
+  printf("      \"mips\": %.3f,\n", result->instructions / result->seconds / 1e6);
+  printf("      \"ns_per_instruction\": %.3f,\n", result->seconds * 1e9 / result->instructions);
+  print_per_instruction("host_cycles_per_instruction", result->host_cycles, result->instructions, false);
+  print_per_instruction("host_instructions_per_instruction", result->host_instructions, result->instructions, true);
+  printf("    }%s\n", last ? "" : ",");
+}
+
+void usage(char *program) {
+  printf("Usage: %s [--scale f] [--repeat n] [--only name] [--movie file]\n", program);
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  double scale = 1;
+  int repeat = 3;
+  char *only = NULL;
+  char *movie_file = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+      scale = atof(argv[++i]);
+      if (scale <= 0) {
+        usage(argv[0]);
+      }
+    } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      repeat = atoi(argv[++i]);
+      if (repeat <= 0) {
+        usage(argv[0]);
+      }
+    } else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+      only = argv[++i];
+    } else if (strcmp(argv[i], "--movie") == 0 && i + 1 < argc) {
+      movie_file = argv[++i];
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  int count = sizeof(workloads) / sizeof(workloads[0]) - 1;
+  if (movie_file != NULL) {
+    if (!movie_read_file(&movie, movie_file)) {
+      exit(1);
+    }
+    workloads[count++].description = movie_file;
+  }
+  int selected = count;
+  if (only != NULL) {
+    selected = 0;
+    for (int i = 0; i < count; i++) {
+      selected += strcmp(workloads[i].name, only) == 0;
+    }
+    if (selected == 0) {
+      printf("Error: unknown workload %s\n", only);
+      exit(1);
+    }
+  }
+
+  HostCounters counters;
+  bool counting = counters_open(&counters);
+
+  printf("{\n");
+  printf("  \"dispatch\": \"%s\",\n", dispatch_engine());
+  printf("  \"trace_level\": %d,\n", TRACE_LEVEL);
+  printf("  \"compiler\": ");
+  print_json_string(COMPILER_VERSION);
+  printf(",\n");
+  printf("  \"scale\": %g,\n", scale);
+  printf("  \"repeat\": %d,\n", repeat);
+  printf("  \"perf_counters\": %s,\n", counting ? "true" : "false");
+  printf("  \"workloads\": [\n");
+  for (int i = 0, printed = 0; i < count; i++) {
+    if (only != NULL && strcmp(workloads[i].name, only) != 0) {
+      continue;
+    }
+    Result best = measure(&workloads[i], scale, &counters, counting);
+    for (int n = 1; n < repeat; n++) {
+      Result result = measure(&workloads[i], scale, &counters, counting);
+      if (result.seconds < best.seconds) {
+        best = result;
+      }
+    }
+    print_result(&workloads[i], &best, ++printed == selected);
+    fflush(stdout);
+  }
+  printf("  ]\n");
+  printf("}\n");
+
+  return 0;
+}
@@ -0,0 +1,133 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "lockstep.h"
+#include "machine.h"
+#include "savestate.h"
+
+// Compares the lockstep engine with running the same lanes one by one through
+// run_frame: bench_lockstep [--lanes n] [--frames n]
+// Every lane inserts a coin and starts a game, then plays its own random walk
+// of moves and shots ("diverged") or the same one as every other lane
+// ("identical"). The lanes of both runs must end in the same state.
+
+static const uint16_t moves[] = {
+  0, INPUT_P1_LEFT, INPUT_P1_RIGHT, INPUT_P1_FIRE, INPUT_P1_LEFT | INPUT_P1_FIRE, INPUT_P1_RIGHT | INPUT_P1_FIRE,
+};
+
+static uint16_t lane_buttons(uint32_t seed, int frame) {
+  if (frame >= 30 && frame < 35) {
+    return INPUT_COIN;
+  }
+  if (frame >= 90 && frame < 95) {
+    return INPUT_P1_START;
+  }
+  // a new move every 8 frames
+  uint32_t hash = (seed * 2654435761u) ^ (uint32_t) (frame / 8) * 40503u;
+  hash ^= hash >> 15;
+  hash *= 2246822519u;
+  hash ^= hash >> 13;
+  return frame < 120 ? 0 : moves[hash % (sizeof(moves) / sizeof(moves[0]))];
+}
+
+static void push_inputs(Batch *batch, int frame, bool diverged) {
+  for (int l = 0; l < batch->count; l++) {
+    input_queue_push(&batch->instances[l]->inputs.queue, lane_buttons(diverged ? l + 1 : 0, frame));
+  }
+}
+
+static bool same_states(Batch *scalar, Batch *lockstep) {
+  size_t size = savestate_size(scalar->instances[0]);
+  uint8_t *expected = malloc(size);
+  uint8_t *actual = malloc(size);
+  bool same = true;
+  for (int l = 0; l < scalar->count && same; l++) {
+    savestate_save(scalar->instances[l], expected);
+    savestate_save(lockstep->instances[l], actual);
+    same = memcmp(expected, actual, size) == 0;
+    if (!same) {
+      printf("lane %d differs\n", l);
+    }
+  }
+  free(expected);
+  free(actual);
+  return same;
+}
+
+int main(int argc, char *argv[]) {
+  int lanes = 64;
+  int frames = 600;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--lanes") == 0 && i + 1 < argc) {
+      lanes = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    } else {
+      printf("Usage: %s [--lanes n] [--frames n]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (lanes <= 0 || frames <= 0) {
+    printf("Error: --lanes and --frames must be positive\n");
+    return 1;
+  }
+
+  SpaceInvaders *prototype = space_invaders_new();
+  program_rom(prototype);
+  static Batch scalar;
+  static Batch lanes_batch;
+  batch_init(&scalar, prototype, lanes);
+  batch_init(&lanes_batch, prototype, lanes);
+
+  printf("%d lanes x %d frames\n", lanes, frames);
+  for (int diverged = 0; diverged <= 1; diverged++) {
+    batch_reset(&scalar);
+    batch_reset(&lanes_batch);
+
+    double start = monotonic_time();
+    for (int frame = 0; frame < frames; frame++) {
+      push_inputs(&scalar, frame, diverged);
+      for (int l = 0; l < lanes; l++) {
+        run_frame(scalar.instances[l]);
+      }
+    }
+    double scalar_time = monotonic_time() - start;
+
+    static Lockstep ls;
+    if (!lockstep_init(&ls, lanes_batch.instances, lanes)) {
+      return 1;
+    }
+    start = monotonic_time();
+    for (int frame = 0; frame < frames; frame++) {
+      push_inputs(&lanes_batch, frame, diverged);
+      lockstep_run_frame(&ls);
+    }
+    double lockstep_time = monotonic_time() - start;
+
+    bool same = same_states(&scalar, &lanes_batch);
+    uint64_t instructions = ls.lockstep_instructions + ls.scalar_instructions;
+    printf(
+      "%-9s scalar %7.0f frames/s  lockstep %7.0f frames/s  %5.2fx  %5.1f%% of instructions in lockstep,"
+      " %4.1f lanes per step  %s\n",
+      diverged ? "diverged" : "identical",
+      lanes * frames / scalar_time,
+      lanes * frames / lockstep_time,
+      scalar_time / lockstep_time,
+      100.0 * ls.lockstep_instructions / instructions,
+      ls.steps > 0 ? (double) ls.lockstep_instructions / ls.steps : 0,
+      same ? "ok" : "MISMATCH"
+    );
+    lockstep_free(&ls);
+    if (!same) {
+      return 1;
+    }
+  }
+
+  batch_free(&scalar);
+  batch_free(&lanes_batch);
+  space_invaders_free(prototype);
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "space_invaders.h"
+#include "video.h"
+
+// Microbenchmark of the VRAM expansion kernels: bench_video [frames]
+
+double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+  int frames = argc > 1 ? atoi(argv[1]) : 20000;
+
+  static uint8_t vram[VRAM_SIZE];
+  srand(8080);
+  for (int i = 0; i < VRAM_SIZE; i++) {
+    vram[i] = rand() % 4 == 0 ? rand() : 0; // mostly dark, like the game screen
+  }
+
+  static Video reference;
+  video_init(&reference, 0xffffffff, 0xff000000);
+  video_set_overlay(&reference, 0xffffffff, 0xff0000ff, 0xff00ff00);
+  reference.kernel = VIDEO_SCALAR;
+  video_expand(&reference, vram);
+
+  double scalar_ns = 0;
+  for (enum VideoKernel kernel = VIDEO_SCALAR; kernel <= VIDEO_AVX2; kernel++) {
+    if (!video_kernel_supported(kernel)) {
+      printf("%-8s unsupported\n", video_kernel_name(kernel));
+      continue;
+    }
+
+    static Video video;
+    video = reference;
+    video.kernel = kernel;
+    memset(video.pixels, 0, sizeof(video.pixels));
+
+    double start = now();
+    for (int i = 0; i < frames; i++) {
+      video_expand(&video, vram);
+    }
+    double ns = (now() - start) * 1e9 / frames;
+
+    bool match = memcmp(video.pixels, reference.pixels, sizeof(video.pixels)) == 0;
+    if (kernel == VIDEO_SCALAR) {
+      scalar_ns = ns;
+    }
+    printf("%-8s %8.0f ns/frame  %5.2fx  %s\n", video_kernel_name(kernel), ns, scalar_ns / ns, match ? "ok" : "MISMATCH");
+    if (!match) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
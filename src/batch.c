@@ -0,0 +1,164 @@
+#include "batch.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "savestate.h"
+
+// A worker and the instances it still has to run, [next, end). Aligned so
+// that workers never share a cache line.
+typedef struct batchWorker {
+  _Alignas(64) pthread_mutex_t lock;
+  int next;
+  int end;
+  int index;
+  int steals;
+  int stopped;
+  uint64_t frames;
+  uint32_t run_frames;
+  pthread_t thread;
+  Batch *batch;
+  struct batchWorker *workers;
+  int worker_count;
+} BatchWorker;
+
+void batch_init(Batch *batch, SpaceInvaders *prototype, int count) {
+  *batch = (Batch) { 0 };
+  batch->count = count;
+  batch->instances = malloc(count * sizeof(SpaceInvaders *));
+  batch->state_size = savestate_size(prototype);
+  batch->state = malloc(batch->state_size);
+  savestate_save(prototype, batch->state);
+
+  Memory *rom = &prototype->memory;
+  for (int i = 0; i < count; i++) {
+    SpaceInvaders *si = space_invaders_new();
+    memory_init(&si->memory, rom->address_mask + 1, rom->rom_size);
+    memory_write(&si->memory, rom->bytes, 0, rom->rom_size);
+    batch->instances[i] = si;
+  }
+  batch_reset(batch);
+}
+
+void batch_free(Batch *batch) {
+  for (int i = 0; i < batch->count; i++) {
+    space_invaders_free(batch->instances[i]);
+  }
+  free(batch->instances);
+  free(batch->state);
+  *batch = (Batch) { 0 };
+}
+
+void batch_reset(Batch *batch) {
+  for (int i = 0; i < batch->count; i++) {
+    SpaceInvaders *si = batch->instances[i];
+    if (!savestate_load(si, batch->state, batch->state_size)) {
+      exit(1);
+    }
+    // buttons queued by an unfinished run
+    while (input_queue_pop(&si->inputs.queue, &si->inputs.buttons)) {
+    }
+  }
+}
+
+static bool take_instance(BatchWorker *worker, int *instance) {
+  pthread_mutex_lock(&worker->lock);
+  bool taken = worker->next < worker->end;
+  if (taken) {
+    *instance = worker->next++;
+  }
+  pthread_mutex_unlock(&worker->lock);
+  return taken;
+}
+
+// Moves the back half of the first non empty range found to the thief. A range
+// in transit between two workers can be missed, the thief then just stops
+// early while its owner still runs it.
+static bool steal_instances(BatchWorker *thief) {
+  for (int i = 1; i < thief->worker_count; i++) {
+    BatchWorker *victim = &thief->workers[(thief->index + i) % thief->worker_count];
+    pthread_mutex_lock(&victim->lock);
+    int remaining = victim->end - victim->next;
+    int half = (remaining + 1) / 2;
+    victim->end -= half;
+    int from = victim->end;
+    pthread_mutex_unlock(&victim->lock);
+    if (half > 0) {
+      pthread_mutex_lock(&thief->lock);
+      thief->next = from;
+      thief->end = from + half;
+      pthread_mutex_unlock(&thief->lock);
+      thief->steals++;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void run_instance(BatchWorker *worker, int instance) {
+  Batch *batch = worker->batch;
+  SpaceInvaders *si = batch->instances[instance];
+  for (uint32_t frame = 0; frame < worker->run_frames; frame++) {
+    if (batch->before_frame != NULL) {
+      batch->before_frame(si, instance, frame, batch->context);
+    }
+    run_frame(si);
+    worker->frames++;
+    if (batch->after_frame != NULL && !batch->after_frame(si, instance, frame, batch->context)) {
+      worker->stopped++;
+      return;
+    }
+  }
+}
+
+static void *worker_thread(void *argument) {
+  BatchWorker *worker = argument;
+  int instance;
+  do {
+    while (take_instance(worker, &instance)) {
+      run_instance(worker, instance);
+    }
+  } while (steal_instances(worker));
+  return NULL;
+}
+
+BatchResult batch_run(Batch *batch, int threads, uint32_t frames) {
+  BatchWorker *workers = aligned_alloc(_Alignof(BatchWorker), threads * sizeof(BatchWorker));
+  for (int i = 0; i < threads; i++) {
+    workers[i] = (BatchWorker) {
+      .next = (int) ((int64_t) batch->count * i / threads),
+      .end = (int) ((int64_t) batch->count * (i + 1) / threads),
+      .index = i,
+      .run_frames = frames,
+      .batch = batch,
+      .workers = workers,
+      .worker_count = threads,
+    };
+    pthread_mutex_init(&workers[i].lock, NULL);
+  }
+
+  double start = monotonic_time();
+  for (int i = 0; i < threads; i++) {
+    if (pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i]) != 0) {
+      printf("Error: unable to start batch worker thread\n");
+      exit(1);
+    }
+  }
+  BatchResult result = { .threads = threads };
+  for (int i = 0; i < threads; i++) {
+    pthread_join(workers[i].thread, NULL);
+    result.frames += workers[i].frames;
+    result.steals += workers[i].steals;
+    result.stopped += workers[i].stopped;
+  }
+  result.elapsed = monotonic_time() - start;
+  for (int i = 0; i < threads; i++) {
+    pthread_mutex_destroy(&workers[i].lock);
+  }
+  free(workers);
+  return result;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "machine.h"
+
+#ifndef BATCH_H
+#define BATCH_H
+
+// Batch of independent game instances stepped in whole frames by a pool of
+// worker threads, e.g. for bot evaluation or replay verification. Each worker
+// starts with a contiguous range of instances and takes them one at a time
+// from its front; a worker that runs out splits off the back half of another
+// worker's remaining range. Instances share nothing, so the only contention
+// is on those ranges, once per instance and run.
+
+// Called before or after each frame of an instance with the frame number
+// within the run. An after_frame hook returning false stops that instance.
+typedef void (*BatchBeforeFrame)(SpaceInvaders *si, int instance, uint32_t frame, void *context);
+typedef bool (*BatchAfterFrame)(SpaceInvaders *si, int instance, uint32_t frame, void *context);
+
+typedef struct batch {
+  SpaceInvaders **instances;
+  int count;
+  uint8_t *state;      // save state of the prototype, restored by batch_reset
+  size_t state_size;
+  BatchBeforeFrame before_frame; // optional, e.g. to feed inputs
+  BatchAfterFrame after_frame;   // optional, e.g. to check the RAM
+  void *context;
+} Batch;
+
+typedef struct batchResult {
+  int threads;
+  uint64_t frames;  // total over all instances
+  double elapsed;
+  int steals;
+  int stopped;      // instances stopped by after_frame
+} BatchResult;
+
+// Creates count instances in the state of the prototype, ROM included
+void batch_init(Batch *batch, SpaceInvaders *prototype, int count);
+void batch_free(Batch *batch);
+// Puts every instance back into the prototype's state
+void batch_reset(Batch *batch);
+// Runs every instance for frames more frames on threads workers
+BatchResult batch_run(Batch *batch, int threads, uint32_t frames);
+
+#endif //BATCH_H
@@ -0,0 +1,56 @@
+#include "cpm.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ports.h"
+
+#define HLT 0x76
+#define JMP 0xc3
+#define OUT 0xd3
+#define RET 0xc9
+
+// BDOS call: function in C, parameter in E or DE
+static void bdos_call(void *device, uint8_t port, uint8_t data) {
+  CpmBdos *bdos = device;
+  if (bdos->console == NULL) {
+    return;
+  }
+  switch (get_register(bdos->cpu, C)) {
+    case BDOS_CONSOLE_OUTPUT:
+      fputc(get_register(bdos->cpu, E), bdos->console);
+      break;
+    case BDOS_PRINT_STRING:
+      for (uint16_t address = get_register_pair(bdos->cpu, D_PAIR); bdos->memory->bytes[address] != '$'; address++) {
+        fputc(bdos->memory->bytes[address], bdos->console);
+      }
+      break;
+  }
+}
+
+void cpm_load(SpaceInvaders *si, CpmBdos *bdos, char *filename) {
+  memory_init(&si->memory, MEMORY_BYTES, 0);
+  memset(si->memory.bytes, 0, MEMORY_BYTES);
+
+  // no Space Invaders devices, only the BDOS trap
+  bdos->cpu = &si->cpu;
+  bdos->memory = &si->memory;
+  bdos->console = stdout;
+  ports_init(&si->ports);
+  ports_map_write(&si->ports, CPM_BDOS_PORT, bdos_call, bdos);
+
+  uint8_t warm_boot[] = { HLT };
+  uint8_t bdos_entry[] = { JMP, CPM_BDOS_ADDRESS & 0xff, CPM_BDOS_ADDRESS >> 8 };
+  uint8_t bdos_stub[] = { OUT, CPM_BDOS_PORT, RET };
+  memory_write(&si->memory, warm_boot, 0x0000, sizeof(warm_boot));
+  memory_write(&si->memory, bdos_entry, 0x0005, sizeof(bdos_entry));
+  memory_write(&si->memory, bdos_stub, CPM_BDOS_ADDRESS, sizeof(bdos_stub));
+  load_rom(si, CPM_TPA_ADDRESS, filename);
+
+  // a program returning from its entry point warm boots
+  si->cpu.pc = CPM_TPA_ADDRESS;
+  si->cpu.sp = CPM_BDOS_ADDRESS - 2;
+  si->memory.bytes[si->cpu.sp] = 0x00;
+  si->memory.bytes[si->cpu.sp + 1] = 0x00;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+#include "machine.h"
+
+#ifndef CPM_H
+#define CPM_H
+
+// Just enough of CP/M to run the 8080 test programs in roms/: a .COM file is
+// loaded at 0x0100 with the full 64 KB mapped as RAM, CALL 5 reaches a BDOS
+// stub whose OUT is trapped by a port device, and jumping to the warm boot
+// vector at 0x0000 halts the CPU.
+#define CPM_TPA_ADDRESS 0x0100
+#define CPM_BDOS_ADDRESS 0xfe00 // also the top of the TPA programs read at 0x0006
+#define CPM_BDOS_PORT 0xff
+
+#define BDOS_CONSOLE_OUTPUT 2
+#define BDOS_PRINT_STRING 9
+
+typedef struct cpmBdos {
+  I8080 *cpu;
+  Memory *memory;
+  FILE *console; // stdout after cpm_load, NULL discards the output
+} CpmBdos;
+
+void cpm_load(SpaceInvaders *si, CpmBdos *bdos, char *filename);
+
+#endif //CPM_H
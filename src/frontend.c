@@ -0,0 +1,429 @@
+#include "machine.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "input.h"
+#include "movie.h"
+#include "raylib.h"
+#include "rewind.h"
+#include "savestate.h"
+#include "trace.h"
+#include "triple_buffer.h"
+#include "video.h"
+
+const int scale = 3;
+const int offset = 3;
+const Color color1 = BLACK;
+const Color color2 = GREEN;
+const int turbo_key = KEY_TAB;
+const int save_state_key = KEY_F5;
+const int load_state_key = KEY_F9;
+const int rewind_key = KEY_BACKSPACE;
+const int rewind_keyframe_interval = 30;
+const int stats_interval = 60;
+
+// Screen update counters, printed every stats_interval drawn frames
+typedef struct renderStats {
+  uint64_t frames;          // emulated frames
+  uint64_t renders;
+  uint64_t uploads_skipped; // renders without VRAM changes
+  uint64_t rows_uploaded;
+  uint64_t vram_writes;
+  uint64_t vram_dirty_bytes;
+} RenderStats;
+
+typedef struct frontend {
+  int frame_skip; // frames emulated but not drawn after each drawn one
+  const char *state_file; // saved with save_state_key, loaded with load_state_key
+  int rewind_seconds;     // history kept for rewind_key, 0 disables it
+  const char *record;     // movie file written on exit, NULL when not recording
+  bool turbo;     // uncapped speed, toggled with turbo_key
+  bool overlay;   // colored bands of the cabinet overlay
+  bool stats;     // print RenderStats
+  RenderStats render_stats;
+} Frontend;
+
+enum StateRequest {
+  STATE_REQUEST_NONE,
+  STATE_REQUEST_SAVE,
+  STATE_REQUEST_LOAD,
+};
+
+// Shared by the emulation thread and the frontend
+typedef struct emulation {
+  SpaceInvaders *si;
+  TripleBuffer frames;
+  int frame_skip;
+  const char *state_file;
+  atomic_int state_request; // StateRequest, set by the frontend, handled between frames
+  RewindHistory *history;   // NULL when rewinding is disabled
+  atomic_bool rewinding;    // rewind_key held: step back a frame instead of running one
+  Movie *movie;             // being recorded, NULL otherwise
+  atomic_bool turbo;
+  atomic_bool quit;    // set by the frontend
+  atomic_bool stopped; // set by the emulation when the CPU halts for good
+} Emulation;
+
+uint32_t color_pixel(Color color) {
+  uint32_t pixel;
+  memcpy(&pixel, &color, sizeof(pixel));
+  return pixel;
+}
+
+void print_render_stats(RenderStats *stats) {
+  printf(
+    "%llu frames: %.1f VRAM writes, %.1f dirty bytes per frame, %.1f rows uploaded per draw, %llu/%llu uploads skipped\n",
+    (unsigned long long) stats->frames,
+    (double) stats->vram_writes / stats->frames,
+    (double) stats->vram_dirty_bytes / stats->frames,
+    (double) stats->rows_uploaded / stats->renders,
+    (unsigned long long) stats->uploads_skipped,
+    (unsigned long long) stats->renders
+  );
+  *stats = (RenderStats) { 0 };
+}
+
+// Presents the latest frame of the emulation thread, or the previous one
+// again if there is none newer
+void render_frame(FrameSlot *frame, uint64_t *frames, Video *video, Texture2D screen, Frontend *frontend) {
+  RenderStats *stats = &frontend->render_stats;
+  if (frame != NULL) {
+    VramDirty *dirty = &frame->dirty;
+    // frames run backwards while rewinding or after loading an older state
+    stats->frames += frame->frames > *frames ? frame->frames - *frames : *frames - frame->frames;
+    *frames = frame->frames;
+    stats->renders++;
+    stats->vram_writes += dirty->writes;
+    stats->vram_dirty_bytes += dirty->bytes;
+
+    // only the rows of changed stripes are expanded and uploaded
+    int from, to;
+    if (video_expand_dirty(video, frame->vram, dirty, &from, &to)) {
+      Rectangle rows = { 0.0f, (float) from, (float) SCREEN_WIDTH, (float) (to - from + 1) };
+      UpdateTextureRec(screen, rows, video->pixels + from * SCREEN_WIDTH);
+      stats->rows_uploaded += to - from + 1;
+    } else {
+      stats->uploads_skipped++;
+    }
+  }
+
+  BeginDrawing();
+    ClearBackground(color2);
+    Vector2 position = { (float) offset, (float) offset };
+    DrawTextureEx(screen, position, 0.0f, (float) scale, WHITE);
+  EndDrawing();
+
+  if (frontend->stats && frame != NULL && stats->renders == stats_interval) {
+    print_render_stats(stats);
+  }
+}
+
+void sleep_until(double time) {
+  double seconds = time - monotonic_time();
+  if (seconds > 0) {
+    struct timespec duration = { (time_t) seconds, (long) ((seconds - (time_t) seconds) * 1e9) };
+    nanosleep(&duration, NULL);
+  }
+}
+
+// Hands the frame just emulated to the frontend. A frame the frontend has not
+// taken yet gets replaced, so its VRAM changes are carried into the new one.
+void publish_frame(SpaceInvaders *si, TripleBuffer *frames) {
+  FrameSlot *slot = triple_buffer_back(frames);
+  memcpy(slot->vram, &si->memory.bytes[VRAM_ADDRESS], VRAM_SIZE);
+  slot->dirty = si->memory.vram_dirty;
+  slot->frames = si->frames;
+  FrameSlot *untaken = triple_buffer_untaken(frames);
+  if (untaken != NULL) {
+    vram_dirty_merge(&slot->dirty, &untaken->dirty);
+  }
+  triple_buffer_publish(frames);
+  memory_clear_vram_dirty(&si->memory);
+}
+
+void handle_state_request(SpaceInvaders *si, Emulation *emulation) {
+  switch (atomic_exchange(&emulation->state_request, STATE_REQUEST_NONE)) {
+    case STATE_REQUEST_SAVE:
+      if (savestate_write_file(si, emulation->state_file)) {
+        printf("saved state at frame %llu to %s\n", (unsigned long long) si->frames, emulation->state_file);
+      }
+      break;
+    case STATE_REQUEST_LOAD:
+      if (emulation->movie != NULL) {
+        printf("Warning: states can't be loaded while recording a movie\n");
+      } else if (savestate_read_file(si, emulation->state_file)) {
+        printf("loaded state at frame %llu from %s\n", (unsigned long long) si->frames, emulation->state_file);
+      }
+      break;
+  }
+}
+
+// Emulation thread: runs frames at 60 Hz, or as fast as it can in turbo mode,
+// independently of the display refresh
+void *emulate(void *arg) {
+  Emulation *emulation = arg;
+  SpaceInvaders *si = emulation->si;
+  const double frame_time = 1.0 / FRAMES_PER_SECOND;
+  double next_frame = monotonic_time();
+
+  while (!atomic_load(&emulation->quit) && !is_stopped(&si->cpu)) {
+    handle_state_request(si, emulation);
+    if (emulation->history != NULL && atomic_load(&emulation->rewinding)) {
+      inputs_next_frame(&si->inputs); // drop the controls sampled meanwhile
+      rewind_step_back(emulation->history, si);
+    } else {
+      run_frame(si);
+      if (emulation->history != NULL) {
+        rewind_push(emulation->history, si);
+      }
+      if (emulation->movie != NULL) {
+        movie_record_frame(emulation->movie, si);
+      }
+    }
+    bool turbo = atomic_load(&emulation->turbo);
+    if (si->frames % (emulation->frame_skip + 1) == 0) {
+      // in turbo mode frames the frontend would drop are not even copied,
+      // their changes keep accumulating until it takes the last one
+      if (!turbo || triple_buffer_untaken(&emulation->frames) == NULL) {
+        publish_frame(si, &emulation->frames);
+      }
+    }
+
+    double now = monotonic_time();
+    next_frame += frame_time;
+    if (turbo || next_frame < now - frame_time) {
+      // don't try to catch up after fast-forward or a stall, e.g. while tracing
+      next_frame = now;
+    } else {
+      sleep_until(next_frame);
+    }
+  }
+
+  atomic_store(&emulation->stopped, true);
+  return NULL;
+}
+
+typedef struct keyBinding {
+  int key;
+  enum InputButton button;
+} KeyBinding;
+
+static const KeyBinding key_bindings[] = {
+  { KEY_C, INPUT_COIN },
+  { KEY_ONE, INPUT_P1_START },
+  { KEY_TWO, INPUT_P2_START },
+  { KEY_SPACE, INPUT_P1_FIRE },
+  { KEY_LEFT, INPUT_P1_LEFT },
+  { KEY_RIGHT, INPUT_P1_RIGHT },
+  { KEY_W, INPUT_P2_FIRE },
+  { KEY_A, INPUT_P2_LEFT },
+  { KEY_D, INPUT_P2_RIGHT },
+  { KEY_T, INPUT_TILT },
+};
+
+typedef struct gamepadBinding {
+  int button;
+  enum InputButton buttons[2]; // player 1 and 2 gamepads
+} GamepadBinding;
+
+static const GamepadBinding gamepad_bindings[] = {
+  { GAMEPAD_BUTTON_MIDDLE_LEFT, { INPUT_COIN, INPUT_COIN } },
+  { GAMEPAD_BUTTON_MIDDLE_RIGHT, { INPUT_P1_START, INPUT_P2_START } },
+  { GAMEPAD_BUTTON_RIGHT_FACE_DOWN, { INPUT_P1_FIRE, INPUT_P2_FIRE } },
+  { GAMEPAD_BUTTON_LEFT_FACE_LEFT, { INPUT_P1_LEFT, INPUT_P2_LEFT } },
+  { GAMEPAD_BUTTON_LEFT_FACE_RIGHT, { INPUT_P1_RIGHT, INPUT_P2_RIGHT } },
+};
+
+// Keyboard and gamepad state of the frame being drawn
+uint16_t sample_controls(void) {
+  uint16_t buttons = 0;
+  for (size_t i = 0; i < sizeof(key_bindings) / sizeof(key_bindings[0]); i++) {
+    if (IsKeyDown(key_bindings[i].key)) {
+      buttons |= key_bindings[i].button;
+    }
+  }
+  for (int player = 0; player < 2; player++) {
+    if (!IsGamepadAvailable(player)) {
+      continue;
+    }
+    for (size_t i = 0; i < sizeof(gamepad_bindings) / sizeof(gamepad_bindings[0]); i++) {
+      if (IsGamepadButtonDown(player, gamepad_bindings[i].button)) {
+        buttons |= gamepad_bindings[i].buttons[player];
+      }
+    }
+  }
+  return buttons;
+}
+
+void set_speed(Frontend *frontend) {
+  // the display only needs to keep up with the frames the emulation publishes
+  SetTargetFPS(frontend->turbo ? FRAMES_PER_SECOND : FRAMES_PER_SECOND / (frontend->frame_skip + 1));
+}
+
+void run(SpaceInvaders *si, Frontend *frontend) {
+  InitWindow(SCREEN_WIDTH * scale + offset * 2, SCREEN_HEIGHT * scale + offset * 2, "Space Invaders");
+  set_speed(frontend);
+
+  static Video video;
+  video_init(&video, color_pixel(color2), color_pixel(color1));
+  if (frontend->overlay) {
+    video_set_overlay(&video, color_pixel(WHITE), color_pixel(RED), color_pixel(GREEN));
+  }
+  printf("using %s video kernel\n", video_kernel_name(video.kernel));
+  Image image = GenImageColor(SCREEN_WIDTH, SCREEN_HEIGHT, color1);
+  Texture2D screen = LoadTextureFromImage(image);
+  UnloadImage(image);
+
+  // TODO: specify rom to load from program arg
+  program_rom(si);
+  //  program_hardcoded(si);
+
+  static Emulation emulation;
+  emulation.si = si;
+  emulation.frame_skip = frontend->frame_skip;
+  emulation.state_file = frontend->state_file;
+  atomic_init(&emulation.state_request, STATE_REQUEST_NONE);
+  // a movie is one continuous run, so recording disables rewinding
+  static Movie movie;
+  if (frontend->record != NULL) {
+    movie_record_start(&movie, si);
+    emulation.movie = &movie;
+  }
+  static RewindHistory history;
+  if (frontend->rewind_seconds > 0 && frontend->record == NULL) {
+    rewind_init(&history, si, frontend->rewind_seconds * FRAMES_PER_SECOND, rewind_keyframe_interval);
+    emulation.history = &history;
+  }
+  atomic_init(&emulation.rewinding, false);
+  triple_buffer_init(&emulation.frames);
+  atomic_init(&emulation.turbo, frontend->turbo);
+  atomic_init(&emulation.quit, false);
+  atomic_init(&emulation.stopped, false);
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, emulate, &emulation) != 0) {
+    printf("Error: unable to start the emulation thread\n");
+    exit(1);
+  }
+
+  // the frontend only forwards input and presents frames
+  uint64_t frames = 0;
+  while (!WindowShouldClose() && !atomic_load(&emulation.stopped))
+  {
+    if (IsKeyPressed(turbo_key)) {
+      frontend->turbo = !frontend->turbo;
+      atomic_store(&emulation.turbo, frontend->turbo);
+      set_speed(frontend);
+    }
+    if (IsKeyPressed(save_state_key)) {
+      atomic_store(&emulation.state_request, STATE_REQUEST_SAVE);
+    } else if (IsKeyPressed(load_state_key)) {
+      atomic_store(&emulation.state_request, STATE_REQUEST_LOAD);
+    }
+    atomic_store(&emulation.rewinding, IsKeyDown(rewind_key));
+    input_queue_push(&si->inputs.queue, sample_controls());
+
+    render_frame(triple_buffer_take(&emulation.frames), &frames, &video, screen, frontend);
+  }
+
+  atomic_store(&emulation.quit, true);
+  pthread_join(thread, NULL);
+  if (emulation.history != NULL) {
+    rewind_free(emulation.history);
+  }
+  if (emulation.movie != NULL && movie_write_file(&movie, frontend->record)) {
+    printf("recorded %u frames to %s\n", movie.count, frontend->record);
+  }
+
+  UnloadTexture(screen);
+
+  CloseWindow();
+}
+
+void usage(char *program) {
+  printf(
+    "Usage: %s [-t|--trace off|instructions|bus|full] [--trace-file file [--trace-ring]]"
+    " [--frameskip n] [--turbo] [--overlay] [--stats] [--lives 3-6] [--extra-life 1000|1500] [--no-coin-info]"
+    " [--state file] [--rewind seconds] [--record file]\n",
+    program
+  );
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  SpaceInvaders *si = space_invaders_new();
+  Frontend frontend = { .state_file = "spaceinvaders.state", .rewind_seconds = 60 };
+  char *trace_file = NULL;
+  bool trace_ring = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--trace") == 0) {
+      enum TraceLevel level;
+      if (i + 1 == argc || !trace_level_from_name(argv[++i], &level)) {
+        usage(argv[0]);
+      }
+      set_trace_level(&si->trace, level);
+    } else if (strcmp(argv[i], "--trace-file") == 0 && i + 1 < argc) {
+      trace_file = argv[++i];
+    } else if (strcmp(argv[i], "--trace-ring") == 0) {
+      trace_ring = true;
+    } else if (strcmp(argv[i], "--frameskip") == 0 && i + 1 < argc) {
+      frontend.frame_skip = atoi(argv[++i]);
+      if (frontend.frame_skip < 0 || frontend.frame_skip >= FRAMES_PER_SECOND) {
+        usage(argv[0]);
+      }
+    } else if (strcmp(argv[i], "--turbo") == 0) {
+      frontend.turbo = true;
+    } else if (strcmp(argv[i], "--overlay") == 0) {
+      frontend.overlay = true;
+    } else if (strcmp(argv[i], "--stats") == 0) {
+      frontend.stats = true;
+    } else if (strcmp(argv[i], "--lives") == 0 && i + 1 < argc) {
+      int lives = atoi(argv[++i]);
+      if (lives < 3 || lives > 6) {
+        usage(argv[0]);
+      }
+      si->inputs.dip.lives = lives;
+    } else if (strcmp(argv[i], "--extra-life") == 0 && i + 1 < argc) {
+      int score = atoi(argv[++i]);
+      if (score != 1000 && score != 1500) {
+        usage(argv[0]);
+      }
+      si->inputs.dip.extra_life_early = score == 1000;
+    } else if (strcmp(argv[i], "--no-coin-info") == 0) {
+      si->inputs.dip.coin_info = false;
+    } else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc) {
+      frontend.state_file = argv[++i];
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      frontend.record = argv[++i];
+    } else if (strcmp(argv[i], "--rewind") == 0 && i + 1 < argc) {
+      frontend.rewind_seconds = atoi(argv[++i]);
+      if (frontend.rewind_seconds < 0) {
+        usage(argv[0]);
+      }
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  if (trace_file != NULL) {
+    if (TRACE_LEVEL == TRACE_OFF) {
+      printf("Warning: tracing not compiled in, ignoring --trace-file (rebuild with -DTRACE_LEVEL=instructions or higher)\n");
+    } else {
+      si->trace.recorder = trace_recorder_open(trace_file, trace_ring);
+    }
+  }
+
+  run(si, &frontend);
+
+  if (si->trace.recorder != NULL) {
+    trace_recorder_close(si->trace.recorder);
+  }
+
+  return 0;
+}
@@ -0,0 +1,273 @@
+#include "machine.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "cpm.h"
+#include "movie.h"
+#include "savestate.h"
+#include "trace.h"
+#include "video.h"
+
+// Runs the game without a window as fast as the host allows, e.g. for
+// regression runs: spaceinvaders_headless --frames 600 --output screen.pbm
+// With --cpm it runs a CP/M test program instead until it warm boots:
+// spaceinvaders_headless --cpm roms/8080EXM.COM
+// --min-mips makes a run slower than that an error, for the CTest suite.
+// --load-state skips the boot, --save-state keeps the final state.
+// --record saves the run as a movie, --replay runs one back and stops at the
+// first frame whose RAM differs from the recording.
+// --batch runs that many instances on a thread pool and reports the scaling
+// from one thread up to every core, or only on --threads.
+
+void usage(char *program) {
+  printf(
+    "Usage: %s [--frames n] [--output file.pbm] [--cpm file.com [--min-mips n]]"
+    " [-t|--trace off|instructions|bus|full] [--trace-file file [--trace-ring]]"
+    " [--load-state file] [--save-state file] [--record file] [--replay file]"
+    " [--batch instances [--threads n]]\n",
+    program
+  );
+  exit(1);
+}
+
+void close_trace(SpaceInvaders *si) {
+  if (si->trace.recorder != NULL) {
+    trace_recorder_close(si->trace.recorder);
+  }
+}
+
+int run_cpm(SpaceInvaders *si, char *filename, double min_mips) {
+  static CpmBdos bdos;
+  cpm_load(si, &bdos, filename);
+
+  // nothing raises interrupts here, so HLT ends the program even with
+  // interrupts enabled (8080EXM warm boots right after an EI)
+  double start = monotonic_time();
+  while (!si->cpu.stopped) {
+    si->cycles += run_cycles(si, CYCLES_PER_FRAME);
+  }
+  double elapsed = monotonic_time() - start;
+  close_trace(si);
+
+  double mips = si->instructions / elapsed / 1e6;
+  printf(
+    "\n%llu instructions, %llu T-states in %.3f s: %.1f MIPS, %.1f MHz\n",
+    (unsigned long long) si->instructions,
+    (unsigned long long) si->cycles,
+    elapsed,
+    mips,
+    si->cycles / elapsed / 1e6
+  );
+  if (mips < min_mips) {
+    printf("Error: %.1f MIPS is below the minimum of %.1f\n", mips, min_mips);
+    return 1;
+  }
+  return 0;
+}
+
+static void replay_input(SpaceInvaders *si, int instance, uint32_t frame, void *context) {
+  movie_replay_input(context, si, frame);
+}
+
+static bool replay_check(SpaceInvaders *si, int instance, uint32_t frame, void *context) {
+  return movie_replay_check(context, si, frame);
+}
+
+// Runs the same frames from the same state on 1, 2, 4... threads up to the
+// core count, or only on the given number of threads
+int run_batch(SpaceInvaders *prototype, int instances, int threads, long frames, Movie *movie) {
+  static Batch batch;
+  batch_init(&batch, prototype, instances);
+  if (movie != NULL) {
+    batch.before_frame = replay_input;
+    batch.after_frame = replay_check;
+    batch.context = movie;
+  }
+
+  int cores = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  printf("%d instances x %ld frames, %d cores\n", instances, frames, cores);
+  double single_rate = 0;
+  int stopped = 0;
+  int count = threads > 0 ? threads : 1;
+  int last = threads > 0 ? threads : cores;
+  for (;;) {
+    batch_reset(&batch);
+    BatchResult result = batch_run(&batch, count, (uint32_t) frames);
+    double rate = result.frames / result.elapsed;
+    if (count == 1) {
+      single_rate = rate;
+    }
+    printf(
+      "%3d threads: %.3f s, %.0f frames/s, %.1fx real time",
+      count,
+      result.elapsed,
+      rate,
+      rate / FRAMES_PER_SECOND
+    );
+    if (single_rate > 0) {
+      printf(", %.0f%% efficiency", 100 * rate / (count * single_rate));
+    }
+    printf(", %d steals\n", result.steals);
+    stopped += result.stopped;
+    if (count == last) {
+      break;
+    }
+    count = count * 2 < last ? count * 2 : last;
+  }
+  batch_free(&batch);
+
+  if (stopped > 0) {
+    return 1;
+  }
+  if (movie != NULL) {
+    printf("every replay matched the recorded RAM on every frame\n");
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  SpaceInvaders *si = space_invaders_new();
+  long frames = 10 * FRAMES_PER_SECOND;
+  char *output = NULL;
+  char *load_state = NULL;
+  char *save_state = NULL;
+  char *record = NULL;
+  char *replay = NULL;
+  char *cpm_program = NULL;
+  double min_mips = 0;
+  int batch = 0;
+  int threads = 0;
+  char *trace_file = NULL;
+  bool trace_ring = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = atol(argv[++i]);
+      if (frames <= 0) {
+        usage(argv[0]);
+      }
+    } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "--load-state") == 0 && i + 1 < argc) {
+      load_state = argv[++i];
+    } else if (strcmp(argv[i], "--save-state") == 0 && i + 1 < argc) {
+      save_state = argv[++i];
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replay = argv[++i];
+    } else if (strcmp(argv[i], "--cpm") == 0 && i + 1 < argc) {
+      cpm_program = argv[++i];
+    } else if (strcmp(argv[i], "--min-mips") == 0 && i + 1 < argc) {
+      min_mips = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+      batch = atoi(argv[++i]);
+      if (batch <= 0) {
+        usage(argv[0]);
+      }
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+      if (threads <= 0) {
+        usage(argv[0]);
+      }
+    } else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--trace") == 0) {
+      enum TraceLevel level;
+      if (i + 1 == argc || !trace_level_from_name(argv[++i], &level)) {
+        usage(argv[0]);
+      }
+      set_trace_level(&si->trace, level);
+    } else if (strcmp(argv[i], "--trace-file") == 0 && i + 1 < argc) {
+      trace_file = argv[++i];
+    } else if (strcmp(argv[i], "--trace-ring") == 0) {
+      trace_ring = true;
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (replay != NULL && (record != NULL || load_state != NULL)) {
+    usage(argv[0]); // a movie starts from its own state
+  }
+  if (batch > 0 && (record != NULL || save_state != NULL || output != NULL || cpm_program != NULL)) {
+    usage(argv[0]); // no single final state to keep
+  }
+
+  if (trace_file != NULL) {
+    if (TRACE_LEVEL == TRACE_OFF) {
+      printf("Warning: tracing not compiled in, ignoring --trace-file (rebuild with -DTRACE_LEVEL=instructions or higher)\n");
+    } else {
+      si->trace.recorder = trace_recorder_open(trace_file, trace_ring);
+    }
+  }
+
+  if (cpm_program != NULL) {
+    return run_cpm(si, cpm_program, min_mips);
+  }
+
+  program_rom(si);
+  if (load_state != NULL) {
+    double start = monotonic_time();
+    if (!savestate_read_file(si, load_state)) {
+      exit(1);
+    }
+    printf("state at frame %llu loaded in %.1f us\n", (unsigned long long) si->frames, (monotonic_time() - start) * 1e6);
+  }
+
+  static Movie movie;
+  if (replay != NULL) {
+    if (!movie_read_file(&movie, replay) || !movie_replay_start(&movie, si)) {
+      exit(1);
+    }
+    frames = movie.count;
+  }
+  if (batch > 0) {
+    return run_batch(si, batch, threads, frames, replay != NULL ? &movie : NULL);
+  }
+  if (record != NULL) {
+    movie_record_start(&movie, si);
+  }
+
+  uint64_t first_frame = si->frames;
+  double start = monotonic_time();
+  while (si->frames - first_frame < (uint64_t) frames && !is_stopped(&si->cpu)) {
+    uint32_t frame = si->frames - first_frame;
+    if (replay != NULL) {
+      movie_replay_input(&movie, si, frame);
+    }
+    run_frame(si);
+    if (replay != NULL && !movie_replay_check(&movie, si, frame)) {
+      exit(1);
+    }
+    if (record != NULL) {
+      movie_record_frame(&movie, si);
+    }
+  }
+  double elapsed = monotonic_time() - start;
+  close_trace(si);
+  if (replay != NULL) {
+    printf("replay of %s matched the recorded RAM on every frame\n", replay);
+  }
+  if (record != NULL && !movie_write_file(&movie, record)) {
+    exit(1);
+  }
+
+  uint64_t ran = si->frames - first_frame;
+  printf(
+    "%llu frames in %.3f s, %.1fx real time\n",
+    (unsigned long long) ran,
+    elapsed,
+    ran / (double) FRAMES_PER_SECOND / elapsed
+  );
+  if (save_state != NULL && !savestate_write_file(si, save_state)) {
+    exit(1);
+  }
+  if (output != NULL) {
+    video_write_pbm(&si->memory.bytes[VRAM_ADDRESS], output);
+  }
+
+  return 0;
+}
@@ -4,29 +4,24 @@
 
 #include "space_invaders.h"
 
-#define CARRY_FLAG_POS 0
-#define PARITY_FLAG_POS 2
-#define AUX_CARRY_FLAG_POS 4
-#define ZERO_FLAG_POS 6
-#define SIGN_FLAG_POS 7
-
-const int bitcount[] = {
-  0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
-  1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-  1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-  2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-  1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-  2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-  2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-  3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-  1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-  2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-  2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-  3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-  2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-  3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-  3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-  4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8,
+// Sign, zero and parity (set on even) flags of every result byte
+const uint8_t szp_flags[256] = {
+  0x44, 0x00, 0x00, 0x04, 0x00, 0x04, 0x04, 0x00, 0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x04,
+  0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x00, 0x00, 0x04, 0x00, 0x04, 0x04, 0x00,
+  0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x00, 0x00, 0x04, 0x00, 0x04, 0x04, 0x00,
+  0x04, 0x00, 0x00, 0x04, 0x00, 0x04, 0x04, 0x00, 0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x04,
+  0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x00, 0x00, 0x04, 0x00, 0x04, 0x04, 0x00,
+  0x04, 0x00, 0x00, 0x04, 0x00, 0x04, 0x04, 0x00, 0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x04,
+  0x04, 0x00, 0x00, 0x04, 0x00, 0x04, 0x04, 0x00, 0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x04,
+  0x00, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x04, 0x04, 0x00, 0x00, 0x04, 0x00, 0x04, 0x04, 0x00,
+  0x80, 0x84, 0x84, 0x80, 0x84, 0x80, 0x80, 0x84, 0x84, 0x80, 0x80, 0x84, 0x80, 0x84, 0x84, 0x80,
+  0x84, 0x80, 0x80, 0x84, 0x80, 0x84, 0x84, 0x80, 0x80, 0x84, 0x84, 0x80, 0x84, 0x80, 0x80, 0x84,
+  0x84, 0x80, 0x80, 0x84, 0x80, 0x84, 0x84, 0x80, 0x80, 0x84, 0x84, 0x80, 0x84, 0x80, 0x80, 0x84,
+  0x80, 0x84, 0x84, 0x80, 0x84, 0x80, 0x80, 0x84, 0x84, 0x80, 0x80, 0x84, 0x80, 0x84, 0x84, 0x80,
+  0x84, 0x80, 0x80, 0x84, 0x80, 0x84, 0x84, 0x80, 0x80, 0x84, 0x84, 0x80, 0x84, 0x80, 0x80, 0x84,
+  0x80, 0x84, 0x84, 0x80, 0x84, 0x80, 0x80, 0x84, 0x84, 0x80, 0x80, 0x84, 0x80, 0x84, 0x84, 0x80,
+  0x80, 0x84, 0x84, 0x80, 0x84, 0x80, 0x80, 0x84, 0x84, 0x80, 0x80, 0x84, 0x80, 0x84, 0x84, 0x80,
+  0x84, 0x80, 0x80, 0x84, 0x80, 0x84, 0x84, 0x80, 0x80, 0x84, 0x84, 0x80, 0x84, 0x80, 0x80, 0x84,
 };
 
 bool get_bit(uint8_t byte, uint8_t pos) {
@@ -47,37 +42,21 @@ bool get_sign_flag(I8080 *cpu) {
   return get_bit(cpu->registers[F], SIGN_FLAG_POS);
 }
 
-void set_sign_flag(I8080 *cpu, uint8_t result) {
-  set_bit(&cpu->registers[F], SIGN_FLAG_POS, result >> 7 & 1);
-}
-
 // S[Z]0A0P1C
 bool get_zero_flag(I8080 *cpu) {
   return get_bit(cpu->registers[F], ZERO_FLAG_POS);
 }
 
-void set_zero_flag(I8080 *cpu, uint8_t result) {
-  set_bit(&cpu->registers[F], ZERO_FLAG_POS, result == 0);
-}
-
 // SZ0[A]0P1C
 bool get_auxiliary_carry_flag(I8080 *cpu) {
   return get_bit(cpu->registers[F], AUX_CARRY_FLAG_POS);
 }
 
-void set_auxiliary_carry_flag(I8080 *cpu, bool value) {
-  set_bit(&cpu->registers[F], AUX_CARRY_FLAG_POS, value);
-}
-
 // SZ0A0[P]1C
 bool get_parity_flag(I8080 *cpu) {
   return get_bit(cpu->registers[F], PARITY_FLAG_POS);
 }
 
-void set_parity_flag(I8080 *cpu, uint8_t result) {
-  set_bit(&cpu->registers[F], PARITY_FLAG_POS, bitcount[result] % 2 == 0);
-}
-
 // SZ0A0P1[C]
 bool get_carry_flag(I8080 *cpu) {
   return get_bit(cpu->registers[F], CARRY_FLAG_POS);
@@ -87,6 +66,11 @@ void set_carry_flag(I8080 *cpu, bool value) {
   set_bit(&cpu->registers[F], CARRY_FLAG_POS, value);
 }
 
+// Replaces the flags in mask, leaving the rest of F untouched
+static inline void set_flags(I8080 *cpu, uint8_t mask, uint8_t flags) {
+  cpu->registers[F] = (cpu->registers[F] & ~mask) | flags;
+}
+
 uint8_t get_register(I8080 *cpu, enum Register r) {
   return cpu->registers[r];
 }
@@ -103,68 +87,59 @@ bool nth_carry_occurs(uint32_t a, uint32_t b, uint32_t cin, uint32_t result, int
   return (a ^ b ^ cin ^ result) >> n & 1;
 }
 
-bool half_carry_occurs(int8_t a, uint8_t b, uint8_t result) {
-  return nth_carry_occurs(a, b, 0, result, 4);
-}
-
-bool half_carry_occurs_with_carry_in(int8_t a, int8_t b, int8_t cin, int8_t result) {
-  return nth_carry_occurs(a, b, cin, result, 4);
-}
-
-bool carry_occurs(int16_t a, uint16_t b, uint16_t result) {
-  return nth_carry_occurs(a, b, 0, result, 8);
-}
-
-bool carry_occurs_with_carry_in(int16_t a, uint16_t b, uint16_t cin, uint16_t result) {
-  return nth_carry_occurs(a, b, cin, result, 8);
-}
-
 bool double_carry_occurs(uint32_t a, uint32_t b, uint32_t result) {
   return nth_carry_occurs(a, b, 0, result, 16);
 }
 
+// Carry out of bit 3 lands on bit 4 of a ^ b ^ result, the AC flag position,
+// so the auxiliary carry needs no table
+static inline uint8_t auxiliary_carry(uint8_t a, uint8_t b, uint8_t cin, uint8_t result) {
+  return (a ^ b ^ cin ^ result) & AUX_CARRY_FLAG;
+}
+
+// Subtraction adds the complement with the inverted borrow as carry in; the
+// 8080 keeps the auxiliary carry of that addition and inverts only the carry
 void add_full_accumulator(I8080 *cpu, uint8_t value, uint8_t cin, bool sub) {
   uint8_t a = cpu->registers[A];
-  uint8_t b = sub ? -value : value;
+  uint8_t b = sub ? ~value : value;
+  if (sub) {
+    cin ^= 1;
+  }
   uint16_t result = a + b + cin;
 
-  set_sign_flag(cpu, result);
-  set_zero_flag(cpu, result);
-  set_parity_flag(cpu, result);
-
-  bool hc = half_carry_occurs_with_carry_in(a, b, cin, result);
-  set_auxiliary_carry_flag(cpu, sub ? !hc : hc);
-
-  bool c = carry_occurs_with_carry_in(a, b, cin, result);
-  set_carry_flag(cpu, sub ? !c : c);
+  uint8_t ac = auxiliary_carry(a, b, cin, result);
+  uint8_t c = result >> 8 & CARRY_FLAG;
+  if (sub) {
+    c ^= CARRY_FLAG;
+  }
+  set_flags(cpu, SZP_FLAGS | AUX_CARRY_FLAG | CARRY_FLAG, szp_flags[result & 0xff] | ac | c);
 
   cpu->registers[A] = result;
 }
 
-void increment_register(I8080 *cpu, enum Register r) {
-  uint8_t a = cpu->registers[r];
-  uint8_t b = 1;
-  uint8_t result = a + b;
+uint8_t increment_byte(I8080 *cpu, uint8_t a) {
+  uint8_t result = a + 1;
 
-  set_sign_flag(cpu, result);
-  set_zero_flag(cpu, result);
-  set_parity_flag(cpu, result);
-  set_auxiliary_carry_flag(cpu, half_carry_occurs(a, b, result));
+  set_flags(cpu, SZP_FLAGS | AUX_CARRY_FLAG, szp_flags[result] | auxiliary_carry(a, 1, 0, result));
 
-  cpu->registers[r] = result;
+  return result;
 }
 
-void decrement_register(I8080 *cpu, enum Register r) {
-  uint8_t a = cpu->registers[r];
-  uint8_t b = 1;
-  uint8_t result = a - b; // TODO: use addition always? result = a + (-b) so we can have a uniform (aux) carry flag check?
+// Adds 0xff like the ALU does, so AC is the carry out of bit 3
+uint8_t decrement_byte(I8080 *cpu, uint8_t a) {
+  uint8_t result = a + 0xff;
+
+  set_flags(cpu, SZP_FLAGS | AUX_CARRY_FLAG, szp_flags[result] | auxiliary_carry(a, 0xff, 0, result));
 
-  set_sign_flag(cpu, result);
-  set_zero_flag(cpu, result);
-  set_parity_flag(cpu, result);
-  set_auxiliary_carry_flag(cpu, !half_carry_occurs(a, b, result));
+  return result;
+}
 
-  cpu->registers[r] = result;
+void increment_register(I8080 *cpu, enum Register r) {
+  cpu->registers[r] = increment_byte(cpu, cpu->registers[r]);
+}
+
+void decrement_register(I8080 *cpu, enum Register r) {
+  cpu->registers[r] = decrement_byte(cpu, cpu->registers[r]);
 }
 
 void add_accumulator(I8080 *cpu, uint8_t value) {
@@ -199,13 +174,12 @@ void subtract_register_accumulator_with_borrow(I8080 *cpu, enum Register r) {
   subtract_with_borrow_accumulator(cpu, cpu->registers[r]);
 }
 
+// AC is bit 3 of either operand, carry is cleared
 void and_accumulator(I8080 *cpu, uint8_t value) {
+  uint8_t ac = (cpu->registers[A] | value) << 1 & AUX_CARRY_FLAG;
   cpu->registers[A] &= value;
 
-  set_sign_flag(cpu, cpu->registers[A]);
-  set_zero_flag(cpu, cpu->registers[A]);
-  set_parity_flag(cpu, cpu->registers[A]);
-  set_carry_flag(cpu, 0);
+  set_flags(cpu, SZP_FLAGS | AUX_CARRY_FLAG | CARRY_FLAG, szp_flags[cpu->registers[A]] | ac);
 }
 
 void and_register_accumulator(I8080 *cpu, enum Register r) {
@@ -215,10 +189,7 @@ void and_register_accumulator(I8080 *cpu, enum Register r) {
 void or_accumulator(I8080 *cpu, uint8_t value) {
   cpu->registers[A] |= value;
 
-  set_sign_flag(cpu, cpu->registers[A]);
-  set_zero_flag(cpu, cpu->registers[A]);
-  set_parity_flag(cpu, cpu->registers[A]);
-  set_carry_flag(cpu, 0);
+  set_flags(cpu, SZP_FLAGS | AUX_CARRY_FLAG | CARRY_FLAG, szp_flags[cpu->registers[A]]);
 }
 
 void or_register_accumulator(I8080 *cpu, enum Register r) {
@@ -228,27 +199,18 @@ void or_register_accumulator(I8080 *cpu, enum Register r) {
 void exclusive_or_accumulator(I8080 *cpu, uint8_t value) {
   cpu->registers[A] ^= value;
 
-  set_sign_flag(cpu, cpu->registers[A]);
-  set_zero_flag(cpu, cpu->registers[A]);
-  set_parity_flag(cpu, cpu->registers[A]);
-  set_carry_flag(cpu, 0);
+  set_flags(cpu, SZP_FLAGS | AUX_CARRY_FLAG | CARRY_FLAG, szp_flags[cpu->registers[A]]);
 }
 
 void exclusive_or_register_accumulator(I8080 *cpu, enum Register r) {
   exclusive_or_accumulator(cpu, cpu->registers[r]);
 }
 
-// TODO: reuse subtract logic
+// Subtracts without storing the result
 void compare_accumulator(I8080 *cpu, uint8_t value) {
   uint8_t a = cpu->registers[A];
-  uint8_t b = -value;
-  uint16_t result = a + b;
-
-  set_sign_flag(cpu, result);
-  set_zero_flag(cpu, result);
-  set_parity_flag(cpu, result);
-  set_auxiliary_carry_flag(cpu, !half_carry_occurs(a, b, result));
-  set_carry_flag(cpu, !carry_occurs(a, b, result));
+  add_full_accumulator(cpu, value, 0, true);
+  cpu->registers[A] = a;
 }
 
 void compare_register_accumulator(I8080 *cpu, enum Register r) {
@@ -344,30 +306,28 @@ void load_sp(I8080 *cpu) {
   cpu->sp = get_register_pair(cpu, H_PAIR);
 }
 
+// Adds 0x06 and/or 0x60 to turn a sum of BCD digits back into BCD. The
+// correction goes through the adder, so AC is its carry out of bit 3, and the
+// carry flag is only ever set, never cleared.
 //   6 = 0b0110
 //   9 = 0b1001 (max BCD value)
 // 9+6 = 0b1111
 void decimal_adjust_accumulator(I8080 *cpu) {
   uint8_t acc = get_register(cpu, A);
-
   uint8_t lsb = acc & 0xf;
-  bool half_carry = lsb > 9 || get_auxiliary_carry_flag(cpu);
-  if (half_carry) {
-    acc += 0x06;
-  }
-
   uint8_t msb = acc >> 4;
-  bool carry = msb > 9 || get_carry_flag(cpu);
-  if (carry) {
-    acc += 0x60;
-  }
 
-  set_register(cpu, A, acc);
+  uint8_t correction = 0;
+  if (lsb > 9 || get_auxiliary_carry_flag(cpu)) {
+    correction |= 0x06;
+  }
+  bool carry = get_carry_flag(cpu);
+  if (msb > 9 || (msb == 9 && lsb > 9) || carry) {
+    correction |= 0x60;
+    carry = true;
+  }
 
-  set_sign_flag(cpu, acc);
-  set_zero_flag(cpu, acc);
-  set_parity_flag(cpu, acc);
-  set_auxiliary_carry_flag(cpu, half_carry);
+  add_accumulator(cpu, correction);
   set_carry_flag(cpu, carry);
 }
 
@@ -418,7 +378,7 @@ void jump_if_parity_even(I8080 *cpu, uint16_t address) {
 }
 
 void jump_if_parity_odd(I8080 *cpu, uint16_t address) {
-  if (get_parity_flag(cpu)) {
+  if (!get_parity_flag(cpu)) {
     jump(cpu, address);
   }
 }
@@ -427,18 +387,47 @@ void stop(I8080 *cpu) {
   cpu->stopped = true;
 }
 
+// Halted for good: only an interrupt ends HLT and none can be accepted
 bool is_stopped(I8080 *cpu) {
-  return cpu->stopped;
+  return cpu->stopped && !cpu->interrupt_enabled;
 }
 
 void enable_interrupt(I8080 *cpu) {
   cpu->interrupt_enabled = true;
+  cpu->interrupt_delay = true;
 }
 
 void disable_interrupt(I8080 *cpu) {
   cpu->interrupt_enabled = false;
 }
 
+// Raises the INT line, replacing a request not acknowledged yet
+void request_interrupt(I8080 *cpu, uint8_t vector) {
+  cpu->interrupt_requested = true;
+  cpu->interrupt_vector = vector;
+}
+
+// Called at an instruction boundary: accepts the requested interrupt if
+// interrupts are enabled, returning the RST number to execute instead of the
+// next instruction, otherwise -1. Accepting it disables interrupts and ends HLT.
+int acknowledge_interrupt(I8080 *cpu) {
+  if (cpu->interrupt_delay) {
+    cpu->interrupt_delay = false;
+    return -1;
+  }
+  if (!cpu->interrupt_requested || !cpu->interrupt_enabled) {
+    return -1;
+  }
+  cpu->interrupt_requested = false;
+  cpu->interrupt_enabled = false;
+  cpu->stopped = false;
+  return cpu->interrupt_vector;
+}
+
+bool waiting_for_interrupt(I8080 *cpu) {
+  return cpu->stopped && !(cpu->interrupt_requested && cpu->interrupt_enabled);
+}
+
 void print_state_8080(I8080 *cpu) {
   for (int i = 0; i < REGISTER_COUNT; i++) {
     printf("%c|%02x", register_names[i], cpu->registers[i]);
@@ -0,0 +1,99 @@
+#include "input.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Port bits, active high
+#define INP0_ALWAYS_SET 0x0e
+#define INP0_FIRE 0x10
+#define INP0_LEFT 0x20
+#define INP0_RIGHT 0x40
+
+#define INP1_COIN 0x01
+#define INP1_P2_START 0x02
+#define INP1_P1_START 0x04
+#define INP1_ALWAYS_SET 0x08
+#define INP1_P1_FIRE 0x10
+#define INP1_P1_LEFT 0x20
+#define INP1_P1_RIGHT 0x40
+
+#define INP2_LIVES 0x03 // 3 + value
+#define INP2_TILT 0x04
+#define INP2_EXTRA_LIFE_1000 0x08
+#define INP2_P2_FIRE 0x10
+#define INP2_P2_LEFT 0x20
+#define INP2_P2_RIGHT 0x40
+#define INP2_COIN_INFO_OFF 0x80
+
+bool input_queue_push(InputQueue *queue, uint16_t buttons) {
+  uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+  if (tail - head == INPUT_QUEUE_SIZE) {
+    return false;
+  }
+  queue->snapshots[tail % INPUT_QUEUE_SIZE] = buttons;
+  atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+bool input_queue_pop(InputQueue *queue, uint16_t *buttons) {
+  uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+  if (head == tail) {
+    return false;
+  }
+  *buttons = queue->snapshots[head % INPUT_QUEUE_SIZE];
+  atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+  return true;
+}
+
+void inputs_init(Inputs *inputs) {
+  atomic_init(&inputs->queue.head, 0);
+  atomic_init(&inputs->queue.tail, 0);
+  inputs->buttons = 0;
+  inputs->dip = (DipSwitches) { .lives = 3, .extra_life_early = false, .coin_info = true };
+}
+
+// Without a new snapshot the controls are still held as last seen
+void inputs_next_frame(Inputs *inputs) {
+  input_queue_pop(&inputs->queue, &inputs->buttons);
+}
+
+static uint8_t bit_if(uint16_t buttons, enum InputButton button, uint8_t bit) {
+  return buttons & button ? bit : 0;
+}
+
+static uint8_t inputs_read(void *device, uint8_t port) {
+  Inputs *inputs = device;
+  uint16_t buttons = inputs->buttons;
+  switch (port) {
+    case PORT_INP0:
+      return INP0_ALWAYS_SET
+        | bit_if(buttons, INPUT_P1_FIRE, INP0_FIRE)
+        | bit_if(buttons, INPUT_P1_LEFT, INP0_LEFT)
+        | bit_if(buttons, INPUT_P1_RIGHT, INP0_RIGHT);
+    case PORT_INP1:
+      return INP1_ALWAYS_SET
+        | bit_if(buttons, INPUT_COIN, INP1_COIN)
+        | bit_if(buttons, INPUT_P2_START, INP1_P2_START)
+        | bit_if(buttons, INPUT_P1_START, INP1_P1_START)
+        | bit_if(buttons, INPUT_P1_FIRE, INP1_P1_FIRE)
+        | bit_if(buttons, INPUT_P1_LEFT, INP1_P1_LEFT)
+        | bit_if(buttons, INPUT_P1_RIGHT, INP1_P1_RIGHT);
+    default:
+      return ((inputs->dip.lives - 3) & INP2_LIVES)
+        | (inputs->dip.extra_life_early ? INP2_EXTRA_LIFE_1000 : 0)
+        | (inputs->dip.coin_info ? 0 : INP2_COIN_INFO_OFF)
+        | bit_if(buttons, INPUT_TILT, INP2_TILT)
+        | bit_if(buttons, INPUT_P2_FIRE, INP2_P2_FIRE)
+        | bit_if(buttons, INPUT_P2_LEFT, INP2_P2_LEFT)
+        | bit_if(buttons, INPUT_P2_RIGHT, INP2_P2_RIGHT);
+  }
+}
+
+void inputs_attach(Inputs *inputs, Ports *ports) {
+  ports_map_read(ports, PORT_INP0, inputs_read, inputs);
+  ports_map_read(ports, PORT_INP1, inputs_read, inputs);
+  ports_map_read(ports, PORT_INP2, inputs_read, inputs);
+}
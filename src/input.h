@@ -0,0 +1,60 @@
+#pragma once
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ports.h"
+
+#ifndef INPUT_H
+#define INPUT_H
+
+// Cabinet controls, one bit each in an input snapshot
+enum InputButton {
+  INPUT_COIN = 1 << 0,
+  INPUT_P1_START = 1 << 1,
+  INPUT_P2_START = 1 << 2,
+  INPUT_P1_FIRE = 1 << 3,
+  INPUT_P1_LEFT = 1 << 4,
+  INPUT_P1_RIGHT = 1 << 5,
+  INPUT_P2_FIRE = 1 << 6,
+  INPUT_P2_LEFT = 1 << 7,
+  INPUT_P2_RIGHT = 1 << 8,
+  INPUT_TILT = 1 << 9,
+};
+
+// Operator settings read through INP2
+typedef struct dipSwitches {
+  uint8_t lives;         // 3 to 6 ships per game
+  bool extra_life_early; // extra ship at 1000 points instead of 1500
+  bool coin_info;        // show the coin info on the attract screen
+} DipSwitches;
+
+#define INPUT_QUEUE_SIZE 16 // power of two
+
+// Single producer / single consumer queue of per-frame input snapshots: the
+// frontend pushes the controls it sampled each drawn frame, the emulation
+// pops one per emulated frame so even a one-frame press reaches the game.
+// Neither side ever waits, a push to a full queue is dropped.
+typedef struct inputQueue {
+  uint16_t snapshots[INPUT_QUEUE_SIZE];
+  _Atomic uint32_t head; // next snapshot to pop, written by the consumer
+  _Atomic uint32_t tail; // next slot to push, written by the producer
+} InputQueue;
+
+bool input_queue_push(InputQueue *queue, uint16_t buttons);
+bool input_queue_pop(InputQueue *queue, uint16_t *buttons);
+
+// INP0 / INP1 / INP2 device: the buttons held during the current frame plus
+// the DIP switches
+typedef struct inputs {
+  InputQueue queue;
+  uint16_t buttons;
+  DipSwitches dip;
+} Inputs;
+
+void inputs_init(Inputs *inputs);
+void inputs_attach(Inputs *inputs, Ports *ports);
+// Called by the emulation at the start of each frame
+void inputs_next_frame(Inputs *inputs);
+
+#endif //INPUT_H
@@ -0,0 +1,985 @@
+// Instruction semantics, shared by every dispatch engine in machine.c.
+// Not a regular header: it is included once per engine, after defining
+// INSTRUCTION(opcode, body). Bodies run with si in scope and set taken when a
+// conditional CALL/RET is taken.
+
+INSTRUCTION(0x00, {
+  no_operation(si);
+})
+INSTRUCTION(0x01, {
+  uint16_t data = fetch_word(si);
+  print_instruction(si, "LXI B,%04x", data);
+  set_register_pair(&si->cpu, B_PAIR, data);
+})
+INSTRUCTION(0x02, {
+  print_instruction(si, "STAX B");
+  uint8_t data = get_register(&si->cpu, A);
+  register_pair_write_byte(si, B_PAIR, data);
+})
+INSTRUCTION(0x03, {
+  register_pair_increment(si, B_PAIR);
+})
+INSTRUCTION(0x04, {
+  register_increment(si, B);
+})
+INSTRUCTION(0x05, {
+  register_decrement(si, B);
+})
+INSTRUCTION(0x06, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "MVI B,%02x", data);
+  set_register(&si->cpu, B, data);
+})
+INSTRUCTION(0x07, {
+  print_instruction(si, "RLC");
+  rotate_accumulator_left(&si->cpu);
+})
+INSTRUCTION(0x08, {
+  no_operation(si);
+})
+INSTRUCTION(0x09, {
+  print_instruction(si, "DAD B");
+  double_add(&si->cpu, B_PAIR);
+})
+INSTRUCTION(0x0a, {
+  print_instruction(si, "LDAX B");
+  uint8_t data = register_pair_read_byte(si, B_PAIR);
+  set_register(&si->cpu, A, data);
+})
+INSTRUCTION(0x0b, {
+  register_pair_decrement(si, B_PAIR);
+})
+INSTRUCTION(0x0c, {
+  register_increment(si, C);
+})
+INSTRUCTION(0x0d, {
+  register_decrement(si, C);
+})
+INSTRUCTION(0x0e, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "MVI C,%02x", data);
+  set_register(&si->cpu, C, data);
+})
+INSTRUCTION(0x0f, {
+  print_instruction(si, "RRC");
+  rotate_accumulator_right(&si->cpu);
+})
+INSTRUCTION(0x10, {
+  no_operation(si);
+})
+INSTRUCTION(0x11, {
+  uint16_t data = fetch_word(si);
+  print_instruction(si, "LXI D,%04x", data);
+  set_register_pair(&si->cpu, D_PAIR, data);
+})
+INSTRUCTION(0x12, {
+  print_instruction(si, "STAX D");
+  uint8_t data = get_register(&si->cpu, A);
+  register_pair_write_byte(si, D_PAIR, data);
+})
+INSTRUCTION(0x13, {
+  register_pair_increment(si, D_PAIR);
+})
+INSTRUCTION(0x14, {
+  register_increment(si, D);
+})
+INSTRUCTION(0x15, {
+  register_decrement(si, D);
+})
+INSTRUCTION(0x16, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "MVI D,%02x", data);
+  set_register(&si->cpu, D, data);
+})
+INSTRUCTION(0x17, {
+  print_instruction(si, "RAL");
+  rotate_accumulator_left_through_carry(&si->cpu);
+})
+INSTRUCTION(0x18, {
+  no_operation(si);
+})
+INSTRUCTION(0x19, {
+  print_instruction(si, "DAD D");
+  double_add(&si->cpu, D_PAIR);
+})
+INSTRUCTION(0x1a, {
+  print_instruction(si, "LDAX D");
+  uint8_t data = register_pair_read_byte(si, D_PAIR);
+  set_register(&si->cpu, A, data);
+})
+INSTRUCTION(0x1b, {
+  register_pair_decrement(si, D_PAIR);
+})
+INSTRUCTION(0x1c, {
+  register_increment(si, E);
+})
+INSTRUCTION(0x1d, {
+  register_decrement(si, E);
+})
+INSTRUCTION(0x1e, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "MVI E,%02x", data);
+  set_register(&si->cpu, E, data);
+})
+INSTRUCTION(0x1f, {
+  print_instruction(si, "RAR");
+  rotate_accumulator_right_through_carry(&si->cpu);
+})
+INSTRUCTION(0x20, {
+  no_operation(si);
+})
+INSTRUCTION(0x21, {
+  uint16_t data = fetch_word(si);
+  print_instruction(si, "LXI H,%04x", data);
+  set_register_pair(&si->cpu, H_PAIR, data);
+})
+INSTRUCTION(0x22, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "SHLD %04x", address);
+  uint16_t data = get_register_pair(&si->cpu, H_PAIR);
+  write_word(si, address, data);
+})
+INSTRUCTION(0x23, {
+  register_pair_increment(si, H_PAIR);
+})
+INSTRUCTION(0x24, {
+  register_increment(si, H);
+})
+INSTRUCTION(0x25, {
+  register_decrement(si, H);
+})
+INSTRUCTION(0x26, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "MVI H,%02x", data);
+  set_register(&si->cpu, H, data);
+})
+INSTRUCTION(0x27, {
+  print_instruction(si, "DAA");
+  decimal_adjust_accumulator(&si->cpu);
+})
+INSTRUCTION(0x28, {
+  no_operation(si);
+})
+INSTRUCTION(0x29, {
+  print_instruction(si, "DAD H");
+  double_add(&si->cpu, H_PAIR);
+})
+INSTRUCTION(0x2a, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "LHLD %04x", address);
+  uint16_t data = read_word(si, address);
+  set_register_pair(&si->cpu, H_PAIR, data);
+})
+INSTRUCTION(0x2b, {
+  register_pair_decrement(si, H_PAIR);
+})
+INSTRUCTION(0x2c, {
+  register_increment(si, L);
+})
+INSTRUCTION(0x2d, {
+  register_decrement(si, L);
+})
+INSTRUCTION(0x2e, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "MVI L,%02x", data);
+  set_register(&si->cpu, L, data);
+})
+INSTRUCTION(0x2f, {
+  print_instruction(si, "CMA");
+  complement_accumulator(&si->cpu);
+})
+INSTRUCTION(0x30, {
+  no_operation(si);
+})
+INSTRUCTION(0x31, {
+  uint16_t data = fetch_word(si);
+  print_instruction(si, "LXI SP,%04x", data);
+  set_register_pair(&si->cpu, SP, data);
+})
+INSTRUCTION(0x32, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "STA %04x", address);
+  uint8_t data = get_register(&si->cpu, A);
+  write_byte(si, address, data);
+})
+INSTRUCTION(0x33, {
+  register_pair_increment(si, SP);
+})
+INSTRUCTION(0x34, {
+  print_instruction(si, "INR M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  register_pair_write_byte(si, H_PAIR, increment_byte(&si->cpu, data));
+})
+INSTRUCTION(0x35, {
+  print_instruction(si, "DCR M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  register_pair_write_byte(si, H_PAIR, decrement_byte(&si->cpu, data));
+})
+INSTRUCTION(0x36, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "MVI M,%02x", data);
+  register_pair_write_byte(si, H_PAIR, data);
+})
+INSTRUCTION(0x37, {
+  print_instruction(si, "STC");
+  set_carry(&si->cpu);
+})
+INSTRUCTION(0x38, {
+  no_operation(si);
+})
+INSTRUCTION(0x39, {
+  print_instruction(si, "DAD SP");
+  double_add(&si->cpu, SP);
+})
+INSTRUCTION(0x3a, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "LDA %04x", address);
+  uint8_t data = read_byte(si, address);
+  set_register(&si->cpu, A, data);
+})
+INSTRUCTION(0x3b, {
+  register_pair_decrement(si, SP);
+})
+INSTRUCTION(0x3c, {
+  register_increment(si, A);
+})
+INSTRUCTION(0x3d, {
+  register_decrement(si, A);
+})
+INSTRUCTION(0x3e, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "MVI A,%02x", data);
+  set_register(&si->cpu, A, data);
+})
+INSTRUCTION(0x3f, {
+  print_instruction(si, "CMC");
+  complement_carry(&si->cpu);
+})
+INSTRUCTION(0x40, {
+  register_move(si, B, B);
+})
+INSTRUCTION(0x41, {
+  register_move(si, B, C);
+})
+INSTRUCTION(0x42, {
+  register_move(si, B, D);
+})
+INSTRUCTION(0x43, {
+  register_move(si, B, E);
+})
+INSTRUCTION(0x44, {
+  register_move(si, B, H);
+})
+INSTRUCTION(0x45, {
+  register_move(si, B, L);
+})
+INSTRUCTION(0x46, {
+  print_instruction(si, "MOV B,M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  set_register(&si->cpu, B, data);
+})
+INSTRUCTION(0x47, {
+  register_move(si, B, A);
+})
+INSTRUCTION(0x48, {
+  register_move(si, C, B);
+})
+INSTRUCTION(0x49, {
+  register_move(si, C, C);
+})
+INSTRUCTION(0x4a, {
+  register_move(si, C, D);
+})
+INSTRUCTION(0x4b, {
+  register_move(si, C, E);
+})
+INSTRUCTION(0x4c, {
+  register_move(si, C, H);
+})
+INSTRUCTION(0x4d, {
+  register_move(si, C, L);
+})
+INSTRUCTION(0x4e, {
+  print_instruction(si, "MOV C,M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  set_register(&si->cpu, C, data);
+})
+INSTRUCTION(0x4f, {
+  register_move(si, C, A);
+})
+INSTRUCTION(0x50, {
+  register_move(si, D, B);
+})
+INSTRUCTION(0x51, {
+  register_move(si, D, C);
+})
+INSTRUCTION(0x52, {
+  register_move(si, D, D);
+})
+INSTRUCTION(0x53, {
+  register_move(si, D, E);
+})
+INSTRUCTION(0x54, {
+  register_move(si, D, H);
+})
+INSTRUCTION(0x55, {
+  register_move(si, D, L);
+})
+INSTRUCTION(0x56, {
+  print_instruction(si, "MOV D,M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  set_register(&si->cpu, D, data);
+})
+INSTRUCTION(0x57, {
+  register_move(si, D, A);
+})
+INSTRUCTION(0x58, {
+  register_move(si, E, B);
+})
+INSTRUCTION(0x59, {
+  register_move(si, E, C);
+})
+INSTRUCTION(0x5a, {
+  register_move(si, E, D);
+})
+INSTRUCTION(0x5b, {
+  register_move(si, E, E);
+})
+INSTRUCTION(0x5c, {
+  register_move(si, E, H);
+})
+INSTRUCTION(0x5d, {
+  register_move(si, E, L);
+})
+INSTRUCTION(0x5e, {
+  print_instruction(si, "MOV E,M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  set_register(&si->cpu, E, data);
+})
+INSTRUCTION(0x5f, {
+  register_move(si, E, A);
+})
+INSTRUCTION(0x60, {
+  register_move(si, H, B);
+})
+INSTRUCTION(0x61, {
+  register_move(si, H, C);
+})
+INSTRUCTION(0x62, {
+  register_move(si, H, D);
+})
+INSTRUCTION(0x63, {
+  register_move(si, H, E);
+})
+INSTRUCTION(0x64, {
+  register_move(si, H, H);
+})
+INSTRUCTION(0x65, {
+  register_move(si, H, L);
+})
+INSTRUCTION(0x66, {
+  print_instruction(si, "MOV H,M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  set_register(&si->cpu, H, data);
+})
+INSTRUCTION(0x67, {
+  register_move(si, H, A);
+})
+INSTRUCTION(0x68, {
+  register_move(si, L, B);
+})
+INSTRUCTION(0x69, {
+  register_move(si, L, C);
+})
+INSTRUCTION(0x6a, {
+  register_move(si, L, D);
+})
+INSTRUCTION(0x6b, {
+  register_move(si, L, E);
+})
+INSTRUCTION(0x6c, {
+  register_move(si, L, H);
+})
+INSTRUCTION(0x6d, {
+  register_move(si, L, L);
+})
+INSTRUCTION(0x6e, {
+  print_instruction(si, "MOV L,M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  set_register(&si->cpu, L, data);
+})
+INSTRUCTION(0x6f, {
+  register_move(si, L, A);
+})
+INSTRUCTION(0x70, {
+  print_instruction(si, "MOV M,B");
+  uint8_t data = get_register(&si->cpu, B);
+  register_pair_write_byte(si, H_PAIR, data);
+})
+INSTRUCTION(0x71, {
+  print_instruction(si, "MOV M,C");
+  uint8_t data = get_register(&si->cpu, C);
+  register_pair_write_byte(si, H_PAIR, data);
+})
+INSTRUCTION(0x72, {
+  print_instruction(si, "MOV M,D");
+  uint8_t data = get_register(&si->cpu, D);
+  register_pair_write_byte(si, H_PAIR, data);
+})
+INSTRUCTION(0x73, {
+  print_instruction(si, "MOV M,E");
+  uint8_t data = get_register(&si->cpu, E);
+  register_pair_write_byte(si, H_PAIR, data);
+})
+INSTRUCTION(0x74, {
+  print_instruction(si, "MOV M,H");
+  uint8_t data = get_register(&si->cpu, H);
+  register_pair_write_byte(si, H_PAIR, data);
+})
+INSTRUCTION(0x75, {
+  print_instruction(si, "MOV M,L");
+  uint8_t data = get_register(&si->cpu, L);
+  register_pair_write_byte(si, H_PAIR, data);
+})
+INSTRUCTION(0x76, {
+  print_instruction(si, "HLT");
+  stop(&si->cpu);
+})
+INSTRUCTION(0x77, {
+  print_instruction(si, "MOV M,A");
+  uint8_t data = get_register(&si->cpu, A);
+  register_pair_write_byte(si, H_PAIR, data);
+})
+INSTRUCTION(0x78, {
+  register_move(si, A, B);
+})
+INSTRUCTION(0x79, {
+  register_move(si, A, C);
+})
+INSTRUCTION(0x7a, {
+  register_move(si, A, D);
+})
+INSTRUCTION(0x7b, {
+  register_move(si, A, E);
+})
+INSTRUCTION(0x7c, {
+  register_move(si, A, H);
+})
+INSTRUCTION(0x7d, {
+  register_move(si, A, L);
+})
+INSTRUCTION(0x7e, {
+  print_instruction(si, "MOV A,M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  set_register(&si->cpu, A, data);
+})
+INSTRUCTION(0x7f, {
+  register_move(si, A, A);
+})
+INSTRUCTION(0x80, {
+  register_add(si, B);
+})
+INSTRUCTION(0x81, {
+  register_add(si, C);
+})
+INSTRUCTION(0x82, {
+  register_add(si, D);
+})
+INSTRUCTION(0x83, {
+  register_add(si, E);
+})
+INSTRUCTION(0x84, {
+  register_add(si, H);
+})
+INSTRUCTION(0x85, {
+  register_add(si, L);
+})
+INSTRUCTION(0x86, {
+  print_instruction(si, "ADD M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  add_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0x87, {
+  register_add(si, A);
+})
+INSTRUCTION(0x88, {
+  register_add_with_carry(si, B);
+})
+INSTRUCTION(0x89, {
+  register_add_with_carry(si, C);
+})
+INSTRUCTION(0x8a, {
+  register_add_with_carry(si, D);
+})
+INSTRUCTION(0x8b, {
+  register_add_with_carry(si, E);
+})
+INSTRUCTION(0x8c, {
+  register_add_with_carry(si, H);
+})
+INSTRUCTION(0x8d, {
+  register_add_with_carry(si, L);
+})
+INSTRUCTION(0x8e, {
+  print_instruction(si, "ADC M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  add_with_carry_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0x8f, {
+  register_add_with_carry(si, A);
+})
+INSTRUCTION(0x90, {
+  register_subtract(si, B);
+})
+INSTRUCTION(0x91, {
+  register_subtract(si, C);
+})
+INSTRUCTION(0x92, {
+  register_subtract(si, D);
+})
+INSTRUCTION(0x93, {
+  register_subtract(si, E);
+})
+INSTRUCTION(0x94, {
+  register_subtract(si, H);
+})
+INSTRUCTION(0x95, {
+  register_subtract(si, L);
+})
+INSTRUCTION(0x96, {
+  print_instruction(si, "SUB M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  subtract_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0x97, {
+  register_subtract(si, A);
+})
+INSTRUCTION(0x98, {
+  register_subtract_with_borrow(si, B);
+})
+INSTRUCTION(0x99, {
+  register_subtract_with_borrow(si, C);
+})
+INSTRUCTION(0x9a, {
+  register_subtract_with_borrow(si, D);
+})
+INSTRUCTION(0x9b, {
+  register_subtract_with_borrow(si, E);
+})
+INSTRUCTION(0x9c, {
+  register_subtract_with_borrow(si, H);
+})
+INSTRUCTION(0x9d, {
+  register_subtract_with_borrow(si, L);
+})
+INSTRUCTION(0x9e, {
+  print_instruction(si, "SBB M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  subtract_with_borrow_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0x9f, {
+  register_subtract_with_borrow(si, A);
+})
+INSTRUCTION(0xa0, {
+  register_and(si, B);
+})
+INSTRUCTION(0xa1, {
+  register_and(si, C);
+})
+INSTRUCTION(0xa2, {
+  register_and(si, D);
+})
+INSTRUCTION(0xa3, {
+  register_and(si, E);
+})
+INSTRUCTION(0xa4, {
+  register_and(si, H);
+})
+INSTRUCTION(0xa5, {
+  register_and(si, L);
+})
+INSTRUCTION(0xa6, {
+  print_instruction(si, "ANA M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  and_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0xa7, {
+  register_and(si, A);
+})
+INSTRUCTION(0xa8, {
+  register_exclusive_or(si, B);
+})
+INSTRUCTION(0xa9, {
+  register_exclusive_or(si, C);
+})
+INSTRUCTION(0xaa, {
+  register_exclusive_or(si, D);
+})
+INSTRUCTION(0xab, {
+  register_exclusive_or(si, E);
+})
+INSTRUCTION(0xac, {
+  register_exclusive_or(si, H);
+})
+INSTRUCTION(0xad, {
+  register_exclusive_or(si, L);
+})
+INSTRUCTION(0xae, {
+  print_instruction(si, "XRA M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  exclusive_or_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0xaf, {
+  register_exclusive_or(si, A);
+})
+INSTRUCTION(0xb0, {
+  register_or(si, B);
+})
+INSTRUCTION(0xb1, {
+  register_or(si, C);
+})
+INSTRUCTION(0xb2, {
+  register_or(si, D);
+})
+INSTRUCTION(0xb3, {
+  register_or(si, E);
+})
+INSTRUCTION(0xb4, {
+  register_or(si, H);
+})
+INSTRUCTION(0xb5, {
+  register_or(si, L);
+})
+INSTRUCTION(0xb6, {
+  print_instruction(si, "ORA M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  or_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0xb7, {
+  register_or(si, A);
+})
+INSTRUCTION(0xb8, {
+  register_compare(si, B);
+})
+INSTRUCTION(0xb9, {
+  register_compare(si, C);
+})
+INSTRUCTION(0xba, {
+  register_compare(si, D);
+})
+INSTRUCTION(0xbb, {
+  register_compare(si, E);
+})
+INSTRUCTION(0xbc, {
+  register_compare(si, H);
+})
+INSTRUCTION(0xbd, {
+  register_compare(si, L);
+})
+INSTRUCTION(0xbe, {
+  print_instruction(si, "CMP M");
+  uint8_t data = register_pair_read_byte(si, H_PAIR);
+  compare_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0xbf, {
+  register_compare(si, A);
+})
+INSTRUCTION(0xc0, {
+  print_instruction(si, "RNZ");
+  taken = subroutine_return_if_not_zero(si);
+})
+INSTRUCTION(0xc1, {
+  print_instruction(si, "POP B");
+  uint16_t data = stack_pop_word(si);
+  set_register_pair(&si->cpu, B_PAIR, data);
+})
+INSTRUCTION(0xc2, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "JNZ %04x", address);
+  jump_if_not_zero(&si->cpu, address);
+})
+INSTRUCTION(0xc3, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "JMP %04x", address);
+  jump(&si->cpu, address);
+})
+INSTRUCTION(0xc4, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "CNZ %04x", address);
+  taken = subroutine_call_if_not_zero(si, address);
+})
+INSTRUCTION(0xc5, {
+  print_instruction(si, "PUSH B");
+  uint16_t data = get_register_pair(&si->cpu, B_PAIR);
+  stack_push_word(si, data);
+})
+INSTRUCTION(0xc6, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "ADI %02x", data);
+  add_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0xc7, {
+  restart(si, 0);
+})
+INSTRUCTION(0xc8, {
+  print_instruction(si, "RZ");
+  taken = subroutine_return_if_zero(si);
+})
+INSTRUCTION(0xc9, {
+  print_instruction(si, "RET");
+  subroutine_return(si);
+})
+INSTRUCTION(0xca, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "JZ %04x", address);
+  jump_if_zero(&si->cpu, address);
+})
+INSTRUCTION(0xcb, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "JMP %04x", address);
+  jump(&si->cpu, address);
+})
+INSTRUCTION(0xcc, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "CZ %04x", address);
+  taken = subroutine_call_if_zero(si, address);
+})
+INSTRUCTION(0xcd, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "CALL %04x", address);
+  subroutine_call(si, address);
+})
+INSTRUCTION(0xce, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "ACI %02x", data);
+  add_with_carry_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0xcf, {
+  restart(si, 1);
+})
+INSTRUCTION(0xd0, {
+  print_instruction(si, "RNC");
+  taken = subroutine_return_if_no_carry(si);
+})
+INSTRUCTION(0xd1, {
+  print_instruction(si, "POP D");
+  uint16_t data = stack_pop_word(si);
+  set_register_pair(&si->cpu, D_PAIR, data);
+})
+INSTRUCTION(0xd2, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "JNC %04x", address);
+  jump_if_no_carry(&si->cpu, address);
+})
+INSTRUCTION(0xd3, {
+  uint8_t device = fetch_byte(si);
+  print_instruction(si, "OUT %02x", device);
+  uint8_t data = get_register(&si->cpu, A);
+  port_write(&si->ports, device, data);
+  if (tracing(&si->trace, TRACE_INSTRUCTIONS)) {
+    trace_output(device, data);
+  }
+})
+INSTRUCTION(0xd4, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "CNC %04x", address);
+  taken = subroutine_call_if_no_carry(si, address);
+})
+INSTRUCTION(0xd5, {
+  print_instruction(si, "PUSH D");
+  uint16_t data = get_register_pair(&si->cpu, D_PAIR);
+  stack_push_word(si, data);
+})
+INSTRUCTION(0xd6, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "SUI %02x", data);
+  subtract_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0xd7, {
+  restart(si, 2);
+})
+INSTRUCTION(0xd8, {
+  print_instruction(si, "RC");
+  taken = subroutine_return_if_carry(si);
+})
+INSTRUCTION(0xd9, {
+  print_instruction(si, "RET");
+  subroutine_return(si);
+})
+INSTRUCTION(0xda, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "JC %04x", address);
+  jump_if_carry(&si->cpu, address);
+})
+INSTRUCTION(0xdb, {
+  uint8_t device = fetch_byte(si);
+  print_instruction(si, "IN %02x", device);
+  uint8_t data = port_read(&si->ports, device);
+  set_register(&si->cpu, A, data);
+  if (tracing(&si->trace, TRACE_INSTRUCTIONS)) {
+    trace_input(device, data);
+  }
+})
+INSTRUCTION(0xdc, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "CC %04x", address);
+  taken = subroutine_call_if_carry(si, address);
+})
+INSTRUCTION(0xdd, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "CALL %04x", address);
+  subroutine_call(si, address);
+})
+INSTRUCTION(0xde, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "SBI %02x", data);
+  subtract_with_borrow_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0xdf, {
+  restart(si, 3);
+})
+INSTRUCTION(0xe0, {
+  print_instruction(si, "RPO");
+  taken = subroutine_return_if_parity_odd(si);
+})
+INSTRUCTION(0xe1, {
+  print_instruction(si, "POP H");
+  uint16_t data = stack_pop_word(si);
+  set_register_pair(&si->cpu, H_PAIR, data);
+})
+INSTRUCTION(0xe2, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "JPO %04x", address);
+  jump_if_parity_odd(&si->cpu, address);
+})
+INSTRUCTION(0xe3, {
+  print_instruction(si, "XTHL");
+  uint16_t sp_data = read_word(si, si->cpu.sp);
+  uint16_t hl_data = get_register_pair(&si->cpu, H_PAIR);
+  set_register_pair(&si->cpu, H_PAIR, sp_data);
+  write_word(si, si->cpu.sp, hl_data);
+})
+INSTRUCTION(0xe4, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "CPO %04x", address);
+  taken = subroutine_call_if_parity_odd(si, address);
+})
+INSTRUCTION(0xe5, {
+  print_instruction(si, "PUSH H");
+  uint16_t data = get_register_pair(&si->cpu, H_PAIR);
+  stack_push_word(si, data);
+})
+INSTRUCTION(0xe6, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "ANI %02x", data);
+  and_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0xe7, {
+  restart(si, 4);
+})
+INSTRUCTION(0xe8, {
+  print_instruction(si, "RPE");
+  taken = subroutine_return_if_parity_even(si);
+})
+INSTRUCTION(0xe9, {
+  print_instruction(si, "PCHL");
+  load_pc(&si->cpu);
+})
+INSTRUCTION(0xea, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "JPE %04x", address);
+  jump_if_parity_even(&si->cpu, address);
+})
+INSTRUCTION(0xeb, {
+  print_instruction(si, "XCHG");
+  exchange_registers(&si->cpu);
+})
+INSTRUCTION(0xec, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "CPE %04x", address);
+  taken = subroutine_call_if_parity_even(si, address);
+})
+INSTRUCTION(0xed, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "CALL %04x", address);
+  subroutine_call(si, address);
+})
+INSTRUCTION(0xee, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "XRI %02x", data);
+  exclusive_or_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0xef, {
+  restart(si, 5);
+})
+INSTRUCTION(0xf0, {
+  print_instruction(si, "RP");
+  taken = subroutine_return_if_plus(si);
+})
+INSTRUCTION(0xf1, {
+  print_instruction(si, "POP PSW");
+  uint16_t data = stack_pop_word(si);
+  set_register_pair(&si->cpu, PSW, (data & ~FLAGS_UNUSED_MASK) | FLAGS_FIXED_BITS);
+})
+INSTRUCTION(0xf2, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "JP %04x", address);
+  jump_if_positive(&si->cpu, address);
+})
+INSTRUCTION(0xf3, {
+  print_instruction(si, "DI");
+  disable_interrupt(&si->cpu);
+})
+INSTRUCTION(0xf4, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "CP %04x", address);
+  taken = subroutine_call_if_plus(si, address);
+})
+INSTRUCTION(0xf5, {
+  print_instruction(si, "PUSH PSW");
+  uint16_t data = get_register_pair(&si->cpu, PSW);
+  stack_push_word(si, data);
+})
+INSTRUCTION(0xf6, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "ORI %02x", data);
+  or_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0xf7, {
+  restart(si, 6);
+})
+INSTRUCTION(0xf8, {
+  print_instruction(si, "RM");
+  taken = subroutine_return_if_minus(si);
+})
+INSTRUCTION(0xf9, {
+  print_instruction(si, "SPHL");
+  load_sp(&si->cpu);
+})
+INSTRUCTION(0xfa, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "JM %04x", address);
+  jump_if_minus(&si->cpu, address);
+})
+INSTRUCTION(0xfb, {
+  print_instruction(si, "EI");
+  enable_interrupt(&si->cpu);
+})
+INSTRUCTION(0xfc, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "CM %04x", address);
+  taken = subroutine_call_if_minus(si, address);
+})
+INSTRUCTION(0xfd, {
+  uint16_t address = fetch_word(si);
+  print_instruction(si, "CALL %04x", address);
+  subroutine_call(si, address);
+})
+INSTRUCTION(0xfe, {
+  uint8_t data = fetch_byte(si);
+  print_instruction(si, "CPI %02x", data);
+  compare_accumulator(&si->cpu, data);
+})
+INSTRUCTION(0xff, {
+  restart(si, 7);
+})
@@ -0,0 +1,719 @@
+#include "lockstep.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opcodes.h"
+
+// Checked builds send every lane through cycle(), where the bus checks and the
+// trace hooks are
+#if defined(MEMORY_CHECKS) || TRACE_LEVEL > TRACE_OFF
+#define LOCKSTEP_GROUPS 0
+#else
+#define LOCKSTEP_GROUPS 1
+#endif
+
+// Register operands in opcodes: B C D E H L M A
+#define MEMORY_OPERAND 6
+static const uint8_t opcode_registers[8] = { B, C, D, E, H, L, 0, A };
+// Register pair operands: B D H SP, PSW instead of SP for PUSH and POP
+static const uint8_t opcode_pairs[4] = { B_PAIR, D_PAIR, H_PAIR, SP };
+// Flag tested by each pair of conditions: NZ Z, NC C, PO PE, P M
+static const uint8_t condition_flags[4] = { ZERO_FLAG, CARRY_FLAG, PARITY_FLAG, SIGN_FLAG };
+
+// Loops over the lanes of a step, with lanes and group as locals. Register
+// only bodies write every lane through a select instead of branching on the
+// group, which keeps them vectorizable: group is 0 or 1, so -group masks in
+// the new value. Memory accesses go through each lane's own Memory and only
+// touch the group.
+#define FOR_LANES(l) for (int l = 0; l < lanes; l++)
+#define FOR_GROUP(l) FOR_LANES(l) if (group[l])
+#define SELECT(l, array, value) ((array)[l] ^= ((array)[l] ^ (value)) & -group[l])
+
+static void *lane_array(int lanes, size_t size) {
+  size_t bytes = (lanes * size + 63) / 64 * 64;
+  void *array = aligned_alloc(64, bytes);
+  memset(array, 0, bytes);
+  return array;
+}
+
+bool lockstep_init(Lockstep *ls, SpaceInvaders **instances, int lanes) {
+  Memory *rom = &instances[0]->memory;
+  for (int l = 1; l < lanes; l++) {
+    Memory *memory = &instances[l]->memory;
+    if (memory->address_mask != rom->address_mask || memory->rom_size != rom->rom_size
+        || memcmp(memory->bytes, rom->bytes, rom->rom_size) != 0) {
+      printf("Error: lockstep lanes must run the same ROM\n");
+      return false;
+    }
+  }
+
+  *ls = (Lockstep) { .lanes = lanes, .instances = instances };
+  for (int r = 0; r < REGISTER_COUNT; r++) {
+    ls->registers[r] = lane_array(lanes, sizeof(uint8_t));
+  }
+  ls->pc = lane_array(lanes, sizeof(uint16_t));
+  ls->sp = lane_array(lanes, sizeof(uint16_t));
+  ls->frame_cycles = lane_array(lanes, sizeof(int32_t));
+  ls->instructions = lane_array(lanes, sizeof(uint32_t));
+  ls->pending = lane_array(lanes, sizeof(uint8_t));
+  ls->group = lane_array(lanes, sizeof(uint8_t));
+  ls->taken = lane_array(lanes, sizeof(uint8_t));
+  ls->operand = lane_array(lanes, sizeof(uint8_t));
+  return true;
+}
+
+void lockstep_free(Lockstep *ls) {
+  for (int r = 0; r < REGISTER_COUNT; r++) {
+    free(ls->registers[r]);
+  }
+  free(ls->pc);
+  free(ls->sp);
+  free(ls->frame_cycles);
+  free(ls->instructions);
+  free(ls->pending);
+  free(ls->group);
+  free(ls->taken);
+  free(ls->operand);
+  *ls = (Lockstep) { 0 };
+}
+
+// What fetch_opcode or run_until would handle before the next instruction
+static bool lane_pending(I8080 *cpu) {
+  return cpu->stopped || cpu->interrupt_delay || (cpu->interrupt_requested && cpu->interrupt_enabled);
+}
+
+static void load_lane(Lockstep *ls, int l) {
+  I8080 *cpu = &ls->instances[l]->cpu;
+  for (int r = 0; r < REGISTER_COUNT; r++) {
+    ls->registers[r][l] = cpu->registers[r];
+  }
+  ls->pc[l] = cpu->pc;
+  ls->sp[l] = cpu->sp;
+  ls->pending[l] = lane_pending(cpu);
+}
+
+static void store_lane(Lockstep *ls, int l) {
+  I8080 *cpu = &ls->instances[l]->cpu;
+  for (int r = 0; r < REGISTER_COUNT; r++) {
+    cpu->registers[r] = ls->registers[r][l];
+  }
+  cpu->pc = ls->pc[l];
+  cpu->sp = ls->sp[l];
+}
+
+// One instruction of a lane on its own instance. Like run_until, a halted
+// lane idles until the target.
+static void scalar_step(Lockstep *ls, int l, int target) {
+  SpaceInvaders *si = ls->instances[l];
+  store_lane(ls, l);
+  if (!waiting_for_interrupt(&si->cpu)) {
+    ls->frame_cycles[l] += cycle(si);
+    ls->scalar_instructions++;
+  }
+  if (si->cpu.stopped) {
+    ls->frame_cycles[l] = target;
+  }
+  load_lane(ls, l);
+}
+
+
+// szp_flags computed, a table lookup per lane would not vectorize
+static inline uint8_t szp(uint8_t value) {
+  uint8_t parity = value ^ value >> 4;
+  parity ^= parity >> 2;
+  parity ^= parity >> 1;
+  return (value & SIGN_FLAG) | (value == 0) << ZERO_FLAG_POS | (~parity & 1) << PARITY_FLAG_POS;
+}
+
+static inline bool condition(uint8_t flags, int code) {
+  bool set = flags & condition_flags[code >> 1];
+  return code & 1 ? set : !set;
+}
+
+static inline uint16_t lane_pair(Lockstep *ls, int pair, int l) {
+  if (pair == SP) {
+    return ls->sp[l];
+  }
+  return ls->registers[pair][l] << 8 | ls->registers[pair + 1][l];
+}
+
+static inline uint8_t lane_read(Lockstep *ls, int l, uint16_t address) {
+  return memory_read_byte_unchecked(&ls->instances[l]->memory, address);
+}
+
+static inline void lane_write(Lockstep *ls, int l, uint16_t address, uint8_t data) {
+  memory_write_byte_unchecked(&ls->instances[l]->memory, address, data);
+}
+
+static inline void lane_push(Lockstep *ls, int l, uint16_t data) {
+  ls->sp[l] -= 2;
+  lane_write(ls, l, ls->sp[l] + 1, data >> 8);
+  lane_write(ls, l, ls->sp[l], data & 0xff);
+}
+
+static inline uint16_t lane_pop(Lockstep *ls, int l) {
+  uint16_t data = lane_read(ls, l, ls->sp[l]) | lane_read(ls, l, ls->sp[l] + 1) << 8;
+  ls->sp[l] += 2;
+  return data;
+}
+
+// add_full_accumulator on every lane, compare_accumulator without store. The
+// operand can be A itself.
+static inline void add_lanes(Lockstep *ls, const uint8_t *value, bool with_carry, bool sub, bool store) {
+  int lanes = ls->lanes;
+  const uint8_t *restrict group = ls->group;
+  uint8_t *a = ls->registers[A];
+  uint8_t *restrict f = ls->registers[F];
+  FOR_LANES(l) {
+    uint8_t b = sub ? ~value[l] : value[l];
+    uint8_t cin = (with_carry ? f[l] & CARRY_FLAG : 0) ^ sub;
+    uint16_t result = a[l] + b + cin;
+    uint8_t flags = (f[l] & ~(SZP_FLAGS | AUX_CARRY_FLAG | CARRY_FLAG)) | szp(result)
+      | ((a[l] ^ b ^ cin ^ result) & AUX_CARRY_FLAG) | ((result >> 8 & CARRY_FLAG) ^ sub);
+    if (store) {
+      SELECT(l, a, result);
+    }
+    SELECT(l, f, flags);
+  }
+}
+
+// ANA, XRA and ORA: carry cleared, AC only set by ANA
+static inline void logic_lanes(Lockstep *ls, const uint8_t *value, int operation) {
+  int lanes = ls->lanes;
+  const uint8_t *restrict group = ls->group;
+  uint8_t *a = ls->registers[A];
+  uint8_t *restrict f = ls->registers[F];
+  FOR_LANES(l) {
+    uint8_t result;
+    uint8_t ac = 0;
+    if (operation == 4) {
+      result = a[l] & value[l];
+      ac = (a[l] | value[l]) << 1 & AUX_CARRY_FLAG;
+    } else if (operation == 5) {
+      result = a[l] ^ value[l];
+    } else {
+      result = a[l] | value[l];
+    }
+    uint8_t flags = (f[l] & ~(SZP_FLAGS | AUX_CARRY_FLAG | CARRY_FLAG)) | szp(result) | ac;
+    SELECT(l, a, result);
+    SELECT(l, f, flags);
+  }
+}
+
+// ADD ADC SUB SBB ANA XRA ORA CMP, in opcode order
+static void alu_lanes(Lockstep *ls, int operation, const uint8_t *value) {
+  switch (operation) {
+    case 0: add_lanes(ls, value, false, false, true); break;
+    case 1: add_lanes(ls, value, true, false, true); break;
+    case 2: add_lanes(ls, value, false, true, true); break;
+    case 3: add_lanes(ls, value, true, true, true); break;
+    case 4: logic_lanes(ls, value, 4); break;
+    case 5: logic_lanes(ls, value, 5); break;
+    case 6: logic_lanes(ls, value, 6); break;
+    case 7: add_lanes(ls, value, false, true, false); break;
+  }
+}
+
+// F after increment_byte / decrement_byte (delta 0xff)
+static inline uint8_t increment_flags(uint8_t flags, uint8_t value, uint8_t delta) {
+  uint8_t result = value + delta;
+  return (flags & ~(SZP_FLAGS | AUX_CARRY_FLAG)) | szp(result) | ((value ^ delta ^ result) & AUX_CARRY_FLAG);
+}
+
+static void increment_lanes(Lockstep *ls, uint8_t *restrict r, uint8_t delta) {
+  int lanes = ls->lanes;
+  const uint8_t *restrict group = ls->group;
+  uint8_t *restrict f = ls->registers[F];
+  FOR_LANES(l) {
+    SELECT(l, f, increment_flags(f[l], r[l], delta));
+    SELECT(l, r, r[l] + delta);
+  }
+}
+
+static void move_lanes(Lockstep *ls, uint8_t *restrict dst, const uint8_t *restrict src) {
+  int lanes = ls->lanes;
+  const uint8_t *restrict group = ls->group;
+  FOR_LANES(l) {
+    SELECT(l, dst, src[l]);
+  }
+}
+
+// LXI (add false) or INX / DCX (value 1 / 0xffff) on every lane
+static void pair_lanes(Lockstep *ls, int pair, bool add, uint16_t value) {
+  int lanes = ls->lanes;
+  const uint8_t *restrict group = ls->group;
+  if (pair == SP) {
+    uint16_t *restrict sp = ls->sp;
+    FOR_LANES(l) {
+      SELECT(l, sp, (uint16_t) ((add ? sp[l] : 0) + value));
+    }
+    return;
+  }
+  uint8_t *restrict high = ls->registers[pair];
+  uint8_t *restrict low = ls->registers[pair + 1];
+  FOR_LANES(l) {
+    uint16_t result = (add ? high[l] << 8 | low[l] : 0) + value;
+    SELECT(l, high, result >> 8);
+    SELECT(l, low, result & 0xff);
+  }
+}
+
+// Source operand of MOV or an ALU instruction: a register, or M read into the
+// operand scratch
+static const uint8_t *source_lanes(Lockstep *ls, int source) {
+  if (source != MEMORY_OPERAND) {
+    return ls->registers[opcode_registers[source]];
+  }
+  int lanes = ls->lanes;
+  const uint8_t *restrict group = ls->group;
+  FOR_GROUP(l) {
+    ls->operand[l] = lane_read(ls, l, lane_pair(ls, H_PAIR, l));
+  }
+  return ls->operand;
+}
+
+// Executes the instruction at pc on the group, false when it has no lockstep
+// version. code points to the instruction bytes in the shared ROM.
+static bool run_instruction(Lockstep *ls, uint16_t pc, const uint8_t *code) {
+  int lanes = ls->lanes;
+  const uint8_t *restrict group = ls->group;
+  uint8_t opcode = code[0];
+  uint8_t immediate = code[1];
+  uint16_t address = code[1] | code[2] << 8;
+  uint16_t next = pc + opcodes[opcode].size;
+  uint8_t *a = ls->registers[A];
+  uint8_t *f = ls->registers[F];
+  uint16_t *next_pc = ls->pc;
+  int pair = opcode_pairs[opcode >> 4 & 3];
+  int operand = opcode >> 3 & 7; // register or condition
+
+  bool jumps = false;
+  if (opcode >= 0x40 && opcode < 0x80 && opcode != 0x76) { // MOV
+    int src = opcode & 7;
+    if (operand == MEMORY_OPERAND) {
+      const uint8_t *value = ls->registers[opcode_registers[src]];
+      FOR_GROUP(l) {
+        lane_write(ls, l, lane_pair(ls, H_PAIR, l), value[l]);
+      }
+    } else if (operand != src) {
+      move_lanes(ls, ls->registers[opcode_registers[operand]], source_lanes(ls, src));
+    }
+  } else if (opcode >= 0x80 && opcode < 0xc0) { // ADD ... CMP
+    alu_lanes(ls, operand, source_lanes(ls, opcode & 7));
+  } else {
+    switch (opcode) {
+      case 0x00: // NOP
+        break;
+      case 0x01: case 0x11: case 0x21: case 0x31: // LXI
+        pair_lanes(ls, pair, false, address);
+        break;
+      case 0x03: case 0x13: case 0x23: case 0x33: // INX
+        pair_lanes(ls, pair, true, 1);
+        break;
+      case 0x0b: case 0x1b: case 0x2b: case 0x3b: // DCX
+        pair_lanes(ls, pair, true, 0xffff);
+        break;
+      case 0x09: case 0x19: case 0x29: case 0x39: // DAD
+        FOR_GROUP(l) {
+          uint32_t result = (uint32_t) lane_pair(ls, pair, l) + lane_pair(ls, H_PAIR, l);
+          ls->registers[H][l] = result >> 8;
+          ls->registers[L][l] = result & 0xff;
+          f[l] = (f[l] & ~CARRY_FLAG) | (result >> 16 & CARRY_FLAG);
+        }
+        break;
+      case 0x04: case 0x0c: case 0x14: case 0x1c: case 0x24: case 0x2c: case 0x3c: // INR
+        increment_lanes(ls, ls->registers[opcode_registers[operand]], 1);
+        break;
+      case 0x05: case 0x0d: case 0x15: case 0x1d: case 0x25: case 0x2d: case 0x3d: // DCR
+        increment_lanes(ls, ls->registers[opcode_registers[operand]], 0xff);
+        break;
+      case 0x06: case 0x0e: case 0x16: case 0x1e: case 0x26: case 0x2e: case 0x3e: { // MVI
+        uint8_t *r = ls->registers[opcode_registers[operand]];
+        FOR_LANES(l) {
+          SELECT(l, r, immediate);
+        }
+        break;
+      }
+      case 0x34: case 0x35: // INR M, DCR M
+        FOR_GROUP(l) {
+          uint16_t hl = lane_pair(ls, H_PAIR, l);
+          uint8_t value = lane_read(ls, l, hl);
+          uint8_t delta = opcode == 0x34 ? 1 : 0xff;
+          f[l] = increment_flags(f[l], value, delta);
+          lane_write(ls, l, hl, value + delta);
+        }
+        break;
+      case 0x36: // MVI M
+        FOR_GROUP(l) {
+          lane_write(ls, l, lane_pair(ls, H_PAIR, l), immediate);
+        }
+        break;
+      case 0x02: case 0x12: // STAX
+        FOR_GROUP(l) {
+          lane_write(ls, l, lane_pair(ls, pair, l), a[l]);
+        }
+        break;
+      case 0x0a: case 0x1a: // LDAX
+        FOR_GROUP(l) {
+          a[l] = lane_read(ls, l, lane_pair(ls, pair, l));
+        }
+        break;
+      case 0x32: // STA
+        FOR_GROUP(l) {
+          lane_write(ls, l, address, a[l]);
+        }
+        break;
+      case 0x3a: // LDA
+        FOR_GROUP(l) {
+          a[l] = lane_read(ls, l, address);
+        }
+        break;
+      case 0x22: // SHLD
+        FOR_GROUP(l) {
+          lane_write(ls, l, address + 1, ls->registers[H][l]);
+          lane_write(ls, l, address, ls->registers[L][l]);
+        }
+        break;
+      case 0x2a: // LHLD
+        FOR_GROUP(l) {
+          ls->registers[L][l] = lane_read(ls, l, address);
+          ls->registers[H][l] = lane_read(ls, l, address + 1);
+        }
+        break;
+      case 0x27: // DAA, as decimal_adjust_accumulator
+        FOR_GROUP(l) {
+          uint8_t correction = 0;
+          bool carry = f[l] & CARRY_FLAG;
+          if ((a[l] & 0xf) > 9 || (f[l] & AUX_CARRY_FLAG)) {
+            correction |= 0x06;
+          }
+          if (a[l] >> 4 > 9 || (a[l] >> 4 == 9 && (a[l] & 0xf) > 9) || carry) {
+            correction |= 0x60;
+            carry = true;
+          }
+          uint8_t result = a[l] + correction;
+          f[l] = (f[l] & ~(SZP_FLAGS | AUX_CARRY_FLAG | CARRY_FLAG)) | szp(result)
+            | ((a[l] ^ correction ^ result) & AUX_CARRY_FLAG) | carry;
+          a[l] = result;
+        }
+        break;
+      case 0x07: // RLC
+        FOR_LANES(l) {
+          uint8_t msb = a[l] >> 7;
+          SELECT(l, f, (f[l] & ~CARRY_FLAG) | msb);
+          SELECT(l, a, a[l] << 1 | msb);
+        }
+        break;
+      case 0x0f: // RRC
+        FOR_LANES(l) {
+          uint8_t lsb = a[l] & 1;
+          SELECT(l, f, (f[l] & ~CARRY_FLAG) | lsb);
+          SELECT(l, a, lsb << 7 | a[l] >> 1);
+        }
+        break;
+      case 0x17: // RAL
+        FOR_LANES(l) {
+          uint8_t carry = f[l] & CARRY_FLAG;
+          SELECT(l, f, (f[l] & ~CARRY_FLAG) | a[l] >> 7);
+          SELECT(l, a, a[l] << 1 | carry);
+        }
+        break;
+      case 0x1f: // RAR
+        FOR_LANES(l) {
+          uint8_t carry = f[l] & CARRY_FLAG;
+          SELECT(l, f, (f[l] & ~CARRY_FLAG) | (a[l] & 1));
+          SELECT(l, a, carry << 7 | a[l] >> 1);
+        }
+        break;
+      case 0x2f: // CMA
+        FOR_LANES(l) {
+          SELECT(l, a, ~a[l]);
+        }
+        break;
+      case 0x37: // STC
+        FOR_LANES(l) {
+          SELECT(l, f, f[l] | CARRY_FLAG);
+        }
+        break;
+      case 0x3f: // CMC
+        FOR_LANES(l) {
+          SELECT(l, f, f[l] ^ CARRY_FLAG);
+        }
+        break;
+      case 0xeb: { // XCHG
+        uint8_t *d = ls->registers[D];
+        uint8_t *e = ls->registers[E];
+        uint8_t *h = ls->registers[H];
+        uint8_t *low = ls->registers[L];
+        FOR_LANES(l) {
+          uint8_t old_d = d[l];
+          uint8_t old_e = e[l];
+          SELECT(l, d, h[l]);
+          SELECT(l, e, low[l]);
+          SELECT(l, h, old_d);
+          SELECT(l, low, old_e);
+        }
+        break;
+      }
+      case 0xe3: // XTHL
+        FOR_GROUP(l) {
+          uint16_t data = lane_read(ls, l, ls->sp[l]) | lane_read(ls, l, ls->sp[l] + 1) << 8;
+          lane_write(ls, l, ls->sp[l] + 1, ls->registers[H][l]);
+          lane_write(ls, l, ls->sp[l], ls->registers[L][l]);
+          ls->registers[H][l] = data >> 8;
+          ls->registers[L][l] = data & 0xff;
+        }
+        break;
+      case 0xf9: // SPHL
+        FOR_GROUP(l) {
+          ls->sp[l] = lane_pair(ls, H_PAIR, l);
+        }
+        break;
+      case 0xdb: // IN
+        FOR_GROUP(l) {
+          a[l] = port_read(&ls->instances[l]->ports, immediate);
+        }
+        break;
+      case 0xd3: // OUT
+        FOR_GROUP(l) {
+          port_write(&ls->instances[l]->ports, immediate, a[l]);
+        }
+        break;
+      case 0xfb: case 0xf3: // EI, DI: the lanes take the scalar path while EI is pending
+        FOR_GROUP(l) {
+          I8080 *cpu = &ls->instances[l]->cpu;
+          if (opcode == 0xfb) {
+            enable_interrupt(cpu);
+          } else {
+            disable_interrupt(cpu);
+          }
+          ls->pending[l] = lane_pending(cpu);
+        }
+        break;
+      case 0xc6: case 0xce: case 0xd6: case 0xde: case 0xe6: case 0xee: case 0xf6: case 0xfe: // ADI ... CPI
+        memset(ls->operand, immediate, lanes);
+        alu_lanes(ls, operand, ls->operand);
+        break;
+      case 0xc3: // JMP
+        FOR_LANES(l) {
+          SELECT(l, next_pc, address);
+        }
+        jumps = true;
+        break;
+      case 0xc2: case 0xca: case 0xd2: case 0xda: case 0xe2: case 0xea: case 0xf2: case 0xfa: // Jcc
+        FOR_LANES(l) {
+          SELECT(l, next_pc, condition(f[l], operand) ? address : next);
+        }
+        jumps = true;
+        break;
+      case 0xcd: // CALL
+        FOR_GROUP(l) {
+          lane_push(ls, l, next);
+          next_pc[l] = address;
+        }
+        jumps = true;
+        break;
+      case 0xc4: case 0xcc: case 0xd4: case 0xdc: case 0xe4: case 0xec: case 0xf4: case 0xfc: // Ccc
+        FOR_GROUP(l) {
+          ls->taken[l] = condition(f[l], operand);
+          next_pc[l] = next;
+          if (ls->taken[l]) {
+            lane_push(ls, l, next);
+            next_pc[l] = address;
+          }
+        }
+        jumps = true;
+        break;
+      case 0xe9: // PCHL
+        FOR_GROUP(l) {
+          next_pc[l] = lane_pair(ls, H_PAIR, l);
+        }
+        jumps = true;
+        break;
+      case 0xc9: // RET
+        FOR_GROUP(l) {
+          next_pc[l] = lane_pop(ls, l);
+        }
+        jumps = true;
+        break;
+      case 0xc0: case 0xc8: case 0xd0: case 0xd8: case 0xe0: case 0xe8: case 0xf0: case 0xf8: // Rcc
+        FOR_GROUP(l) {
+          ls->taken[l] = condition(f[l], operand);
+          next_pc[l] = ls->taken[l] ? lane_pop(ls, l) : next;
+        }
+        jumps = true;
+        break;
+      case 0xc5: case 0xd5: case 0xe5: // PUSH
+        FOR_GROUP(l) {
+          lane_push(ls, l, lane_pair(ls, pair, l));
+        }
+        break;
+      case 0xf5: // PUSH PSW
+        FOR_GROUP(l) {
+          lane_push(ls, l, a[l] << 8 | f[l]);
+        }
+        break;
+      case 0xc1: case 0xd1: case 0xe1: // POP
+        FOR_GROUP(l) {
+          uint16_t data = lane_pop(ls, l);
+          ls->registers[pair][l] = data >> 8;
+          ls->registers[pair + 1][l] = data & 0xff;
+        }
+        break;
+      case 0xf1: // POP PSW
+        FOR_GROUP(l) {
+          uint16_t data = lane_pop(ls, l);
+          a[l] = data >> 8;
+          f[l] = (data & ~FLAGS_UNUSED_MASK) | FLAGS_FIXED_BITS;
+        }
+        break;
+      default: // HLT, RST and the undocumented duplicates
+        return false;
+    }
+  }
+
+  if (!jumps) {
+    FOR_LANES(l) {
+      SELECT(l, next_pc, next);
+    }
+  }
+  return true;
+}
+
+// Adds the T-states and the instruction to every lane of the group, returns
+// the lanes in it
+static int count_group(Lockstep *ls, const Opcode *opcode) {
+  int lanes = ls->lanes;
+  const uint8_t *restrict group = ls->group;
+  const uint8_t *restrict taken = ls->taken;
+  int32_t *restrict frame_cycles = ls->frame_cycles;
+  uint32_t *restrict instructions = ls->instructions;
+  int cycles = opcode->cycles;
+  // taken only holds results for conditional CALL / RET
+  int cycles_taken = opcode->cycles_taken;
+  int count = 0;
+  // group and taken are 0 or 1, so this is arithmetic rather than selects
+  FOR_LANES(l) {
+    frame_cycles[l] += group[l] * (cycles + taken[l] * (cycles_taken - cycles));
+    instructions[l] += group[l];
+    count += group[l];
+  }
+  return count;
+}
+
+// Runs one instruction for the group at pc: in lockstep when it lies in the
+// shared ROM and has a lockstep version, otherwise lane by lane
+static void run_group(Lockstep *ls, uint16_t pc, int target) {
+  Memory *memory = &ls->instances[0]->memory;
+  const Opcode *opcode = &opcodes[memory->bytes[pc & memory->address_mask]];
+  if (pc + 2 >= memory->rom_size) {
+    opcode = NULL;
+  }
+  if (opcode != NULL && opcode->cycles != opcode->cycles_taken) {
+    memset(ls->taken, 0, ls->lanes);
+  }
+  if (opcode == NULL || !run_instruction(ls, pc, &memory->bytes[pc])) {
+    int lanes = ls->lanes;
+    const uint8_t *group = ls->group;
+    FOR_GROUP(l) {
+      scalar_step(ls, l, target);
+    }
+    return;
+  }
+  ls->steps++;
+  ls->lockstep_instructions += count_group(ls, opcode);
+}
+
+// Lowest PC among the lanes still running that can step in lockstep,
+// 0x10000 when there is none. alone counts the running lanes that have to take
+// the scalar path first.
+static int lowest_pc(Lockstep *ls, int target, int *alone) {
+  int lanes = ls->lanes;
+  const uint16_t *restrict pc = ls->pc;
+  const int32_t *restrict frame_cycles = ls->frame_cycles;
+  const uint8_t *restrict pending = ls->pending;
+  int lowest = 0x10000;
+  int count = 0;
+  FOR_LANES(l) {
+    int running = frame_cycles[l] < target;
+    int scalar = pending[l] | !LOCKSTEP_GROUPS;
+    // lanes out of the running sort above every PC
+    int key = pc[l] + ((running & (scalar ^ 1)) ^ 1) * 0x10000;
+    lowest = key < lowest ? key : lowest;
+    count += running & scalar;
+  }
+  *alone = count;
+  return lowest < 0x10000 ? lowest : 0x10000;
+}
+
+static void find_group(Lockstep *ls, int target, int pc) {
+  int lanes = ls->lanes;
+  uint8_t *restrict group = ls->group;
+  const uint16_t *restrict lane_pc = ls->pc;
+  const int32_t *restrict frame_cycles = ls->frame_cycles;
+  const uint8_t *restrict pending = ls->pending;
+  FOR_LANES(l) {
+    group[l] = (frame_cycles[l] < target) & !pending[l] & (lane_pc[l] == pc);
+  }
+}
+
+// run_until on every lane: lanes needing the scalar path take it first, then
+// the lanes at the lowest PC run one instruction together
+static void run_until(Lockstep *ls, int target) {
+  int lanes = ls->lanes;
+  for (;;) {
+    int alone;
+    int pc = lowest_pc(ls, target, &alone);
+    if (alone > 0) {
+      FOR_LANES(l) {
+        if (ls->frame_cycles[l] < target && (ls->pending[l] || !LOCKSTEP_GROUPS)) {
+          scalar_step(ls, l, target);
+        }
+      }
+    } else if (pc == 0x10000) {
+      return;
+    } else {
+      find_group(ls, target, pc);
+      run_group(ls, pc, target);
+    }
+  }
+}
+
+static void request_interrupts(Lockstep *ls, uint8_t vector) {
+  int lanes = ls->lanes;
+  FOR_LANES(l) {
+    I8080 *cpu = &ls->instances[l]->cpu;
+    request_interrupt(cpu, vector);
+    ls->pending[l] = lane_pending(cpu);
+  }
+}
+
+void lockstep_run_frame(Lockstep *ls) {
+  int lanes = ls->lanes;
+  FOR_LANES(l) {
+    SpaceInvaders *si = ls->instances[l];
+    inputs_next_frame(&si->inputs);
+    load_lane(ls, l);
+    ls->frame_cycles[l] = si->frame_cycles;
+    ls->instructions[l] = 0;
+  }
+
+  run_until(ls, scanline_cycles(MID_SCREEN_SCANLINE));
+  request_interrupts(ls, MID_SCREEN_INTERRUPT);
+  run_until(ls, scanline_cycles(VBLANK_SCANLINE));
+  request_interrupts(ls, VBLANK_INTERRUPT);
+  run_until(ls, CYCLES_PER_FRAME);
+
+  FOR_LANES(l) {
+    SpaceInvaders *si = ls->instances[l];
+    store_lane(ls, l);
+    si->cycles += ls->frame_cycles[l] - si->frame_cycles;
+    si->instructions += ls->instructions[l];
+    si->frame_cycles = ls->frame_cycles[l] - CYCLES_PER_FRAME;
+    si->frames++;
+  }
+}
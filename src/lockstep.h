@@ -0,0 +1,43 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "machine.h"
+
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+// Experimental lockstep engine for many instances of the same ROM. While a
+// frame runs, the registers, PC and SP of every instance (a lane) live in
+// structure-of-arrays form. Each step picks the lowest PC among the lanes
+// still running and executes that instruction once for every lane sitting at
+// it, as a loop over the lanes the compiler can vectorize. Lanes that took
+// other branches wait until the lowest PC catches up with them, which is where
+// diverged lanes meet again. Interrupts, the instruction after EI, HLT and RST
+// go through cycle() on the lane's own instance, so the result
+// is exactly that of run_frame on each instance.
+typedef struct lockstep {
+  int lanes;
+  SpaceInvaders **instances; // memory, devices and the scalar fallback
+  uint8_t *registers[REGISTER_COUNT]; // registers[r][lane]
+  uint16_t *pc;
+  uint16_t *sp;
+  int32_t *frame_cycles;
+  uint32_t *instructions;    // run in lockstep this frame
+  uint8_t *pending;          // interrupt to accept, EI delay or HLT: runs scalar
+  uint8_t *group;            // lanes of the current step
+  uint8_t *taken;            // conditional CALL/RET taken, per lane of the step
+  uint8_t *operand;          // source operand of the step, per lane
+  // statistics
+  uint64_t steps;            // instructions executed for a whole group
+  uint64_t lockstep_instructions;
+  uint64_t scalar_instructions;
+} Lockstep;
+
+// The instances must hold the same ROM, false otherwise
+bool lockstep_init(Lockstep *ls, SpaceInvaders **instances, int lanes);
+void lockstep_free(Lockstep *ls);
+// run_frame on every instance
+void lockstep_run_frame(Lockstep *ls);
+
+#endif //LOCKSTEP_H
@@ -0,0 +1,828 @@
+#include "machine.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "input.h"
+#include "opcodes.h"
+#include "ports.h"
+#include "trace.h"
+
+// load_rom without exiting, false when the file cannot be opened
+static bool read_rom(SpaceInvaders *si, int address, const char *filename) {
+  FILE *f = fopen(filename, "rb");
+  if (f == NULL) {
+    if (!si->quiet) {
+      printf("Error: unable to open %s\n", filename);
+    }
+    return false;
+  }
+  fseek(f, 0L, SEEK_END);
+  int size = ftell(f);
+  fseek(f, 0L, SEEK_SET);
+  if (size < 0 || address + size > si->memory.address_mask + 1) {
+    if (!si->quiet) {
+      printf("Error: %s does not fit in memory at 0x%04x\n", filename, address);
+    }
+    fclose(f);
+    return false;
+  }
+  if (tracing(&si->trace, TRACE_INSTRUCTIONS)) {
+    printf("loading %d bytes from file %s to address 0x%04x\n", size, filename, address);
+  }
+  uint8_t buffer[size];
+  fread(buffer, size, 1, f);
+  fclose(f);
+
+  memory_write(&si->memory, buffer, address, size);
+  return true;
+}
+
+void load_rom(SpaceInvaders *si, int address, char *filename) {
+  if (!read_rom(si, address, filename)) {
+    exit(1);
+  }
+}
+
+bool program_rom_directory(SpaceInvaders *si, const char *directory) {
+  static const struct {
+    int address;
+    const char *name;
+  } files[] = {
+    { ROM_H_ADDRESS, "INVADERS.H" },
+    { ROM_G_ADDRESS, "INVADERS.G" },
+    { ROM_F_ADDRESS, "INVADERS.F" },
+    { ROM_E_ADDRESS, "INVADERS.E" },
+  };
+  for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+    char filename[4096];
+    snprintf(filename, sizeof(filename), "%s/%s", directory, files[i].name);
+    if (!read_rom(si, files[i].address, filename)) {
+      return false;
+    }
+  }
+  if (tracing(&si->trace, TRACE_FULL)) {
+    memory_dump(&si->memory);
+  }
+  return true;
+}
+
+void program_rom(SpaceInvaders *si) {
+  if (!program_rom_directory(si, "roms")) {
+    exit(1);
+  }
+}
+
+void program_hardcoded(SpaceInvaders *si) {
+  uint8_t program[] = {
+      0x26, 0x0d,
+      0x2e, 0xf0,
+      0xe5,
+      0x26, 0x0b,
+      0x2e, 0x3c,
+      0xe3,
+      0x76,
+  };
+  size_t size = sizeof(program)/sizeof(program[0]);
+  memory_init(&si->memory, SPACE_INVADERS_MEMORY_BYTES, 0);
+  memory_write(&si->memory, program, 0, size);
+  if (tracing(&si->trace, TRACE_FULL)) {
+    memory_peek(&si->memory, 0, 0x20);
+  }
+}
+
+SpaceInvaders *space_invaders_new(void) {
+  SpaceInvaders *si = calloc(1, sizeof(SpaceInvaders));
+  si->cpu.sp = SPACE_INVADERS_MEMORY_BYTES & 0xffff;
+  si->cpu.registers[F] = FLAGS_FIXED_BITS;
+  si->trace.level = TRACE_OFF;
+  memory_init(&si->memory, SPACE_INVADERS_MEMORY_BYTES, RAM_ADDRESS);
+  memory_mark_vram_dirty(&si->memory);
+  ports_init(&si->ports);
+  shift_register_attach(&si->shifter, &si->ports);
+  inputs_init(&si->inputs);
+  inputs_attach(&si->inputs, &si->ports);
+  return si;
+}
+
+void space_invaders_free(SpaceInvaders *si) {
+  memory_free(&si->memory);
+  free(si);
+}
+
+// Trace hooks: with TRACE_LEVEL below the hook's level these expand to nothing,
+// so the arguments (mnemonic formatting, memory peeks) are never evaluated.
+#define print_instruction(si, ...) \
+  do { \
+    if (recording(&(si)->trace)) { \
+      trace_record_instruction((si)->trace.recorder); \
+    } \
+    if (tracing(&(si)->trace, TRACE_INSTRUCTIONS)) { \
+      trace_instruction(__VA_ARGS__); \
+    } \
+  } while (0)
+
+#define print_bus(si) \
+  do { \
+    if (recording(&(si)->trace)) { \
+      trace_record_bus((si)->trace.recorder, (si)->write, (si)->address, (si)->data); \
+    } \
+    if (tracing(&(si)->trace, TRACE_BUS)) { \
+      trace_bus((si)->write, (si)->address, (si)->data); \
+    } \
+  } while (0)
+
+void peek_next_bytes(SpaceInvaders *si) {
+  uint16_t mask = si->memory.address_mask;
+  uint8_t first = memory_read_byte(&si->memory, si->cpu.pc & mask);
+  uint8_t second = memory_read_byte(&si->memory, (si->cpu.pc+1) & mask);
+  uint8_t third = memory_read_byte(&si->memory, (si->cpu.pc+2) & mask);
+  trace_next_bytes(first, second, third);
+}
+
+void trace_cycle_begin(SpaceInvaders *si) {
+  if (recording(&si->trace)) {
+    trace_record_begin(si->trace.recorder, si->cpu.pc, &si->memory);
+  }
+  if (tracing(&si->trace, TRACE_FULL)) {
+    peek_next_bytes(si);
+  }
+}
+
+void trace_cycle_end(SpaceInvaders *si) {
+  if (recording(&si->trace)) {
+    trace_record_end(si->trace.recorder, &si->cpu, &si->memory);
+  }
+  if (tracing(&si->trace, TRACE_FULL)) {
+    trace_state(&si->cpu, &si->memory);
+  }
+}
+
+// The checked bus mirrors addresses and drops ROM writes like the unchecked
+// one, then goes through the bounds checked memory accesses and keeps the last
+// access in write/address/data for the bus trace. It is used when tracing is
+// compiled in or with the MEMORY_CHECKS CMake option, other builds go straight
+// to the unchecked memory accesses.
+#if defined(MEMORY_CHECKS) || TRACE_LEVEL > TRACE_OFF
+#define CHECKED_BUS 1
+#else
+#define CHECKED_BUS 0
+#endif
+
+static inline uint8_t read_byte(SpaceInvaders *si, uint16_t address) {
+  if (!CHECKED_BUS) {
+    return memory_read_byte_unchecked(&si->memory, address);
+  }
+  si->write = false;
+  si->address = address & si->memory.address_mask;
+  si->data = memory_read_byte(&si->memory, si->address);
+  print_bus(si);
+  return si->data;
+}
+
+static inline uint16_t read_word(SpaceInvaders *si, uint16_t address) {
+  uint8_t lsb = read_byte(si, address);
+  uint8_t msb = read_byte(si, address+1);
+
+  // little endian
+  return (msb << 8) | lsb;
+}
+
+static inline void write_byte(SpaceInvaders *si, uint16_t address, uint8_t data) {
+  if (!CHECKED_BUS) {
+    memory_write_byte_unchecked(&si->memory, address, data);
+    return;
+  }
+  si->write = true;
+  si->address = address & si->memory.address_mask;
+  si->data = data;
+  memory_write_byte(&si->memory, si->address, si->data);
+  print_bus(si);
+}
+
+static inline void write_word(SpaceInvaders *si, uint16_t address, uint16_t data) {
+  // little endian
+  uint8_t msb = data >> 8;
+  uint8_t lsb = data & 0xff;
+
+  write_byte(si, address+1, msb);
+  write_byte(si, address, lsb);
+}
+
+static inline uint8_t fetch_byte(SpaceInvaders *si) {
+  uint8_t data = read_byte(si, si->cpu.pc);
+  si->cpu.pc++;
+  return data;
+}
+
+// The RST instruction the interrupting device puts on the bus when an
+// interrupt is acknowledged before the next instruction, -1 otherwise
+static inline int interrupt_opcode(SpaceInvaders *si) {
+  if (si->cpu.interrupt_requested | si->cpu.interrupt_delay) {
+    int vector = acknowledge_interrupt(&si->cpu);
+    if (vector >= 0) {
+      uint8_t opcode = RST_OPCODE(vector);
+      if (recording(&si->trace)) {
+        trace_record_interrupt(si->trace.recorder, opcode);
+      }
+      if (tracing(&si->trace, TRACE_INSTRUCTIONS)) {
+        trace_interrupt(opcode);
+      }
+      return opcode;
+    }
+  }
+  return -1;
+}
+
+// Next opcode: the acknowledged interrupt's RST or the byte at PC
+static inline uint8_t fetch_opcode(SpaceInvaders *si) {
+  int opcode = interrupt_opcode(si);
+  return opcode >= 0 ? opcode : fetch_byte(si);
+}
+
+static inline uint16_t fetch_word(SpaceInvaders *si) {
+  uint16_t data = read_word(si, si->cpu.pc);
+  si->cpu.pc+=2;
+  return data;
+}
+
+static inline uint8_t register_pair_read_byte(SpaceInvaders *si, enum RegisterPair r) {
+  uint16_t address = get_register_pair(&si->cpu, r);
+  return read_byte(si, address);
+}
+
+static inline void register_pair_write_byte(SpaceInvaders *si, enum RegisterPair r, uint8_t data) {
+  uint16_t address = get_register_pair(&si->cpu, r);
+  write_byte(si, address, data);
+}
+
+void stack_push_word(SpaceInvaders *si, uint16_t data) {
+  si->cpu.sp-=2;
+  write_word(si, si->cpu.sp, data);
+}
+
+uint16_t stack_pop_word(SpaceInvaders *si) {
+  uint16_t data = read_word(si, si->cpu.sp);
+  si->cpu.sp+=2;
+  return data;
+}
+
+void subroutine_call(SpaceInvaders *si, uint16_t address) {
+  stack_push_word(si, si->cpu.pc);
+  jump(&si->cpu, address);
+}
+
+bool subroutine_call_if_carry(SpaceInvaders *si, uint16_t address) {
+  if (get_carry_flag(&si->cpu)) {
+    subroutine_call(si, address);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_call_if_no_carry(SpaceInvaders *si, uint16_t address) {
+  if (!get_carry_flag(&si->cpu)) {
+    subroutine_call(si, address);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_call_if_zero(SpaceInvaders *si, uint16_t address) {
+  if (get_zero_flag(&si->cpu)) {
+    subroutine_call(si, address);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_call_if_not_zero(SpaceInvaders *si, uint16_t address) {
+  if (!get_zero_flag(&si->cpu)) {
+    subroutine_call(si, address);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_call_if_minus(SpaceInvaders *si, uint16_t address) {
+  if (get_sign_flag(&si->cpu)) {
+    subroutine_call(si, address);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_call_if_plus(SpaceInvaders *si, uint16_t address) {
+  if (!get_sign_flag(&si->cpu)) {
+    subroutine_call(si, address);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_call_if_parity_even(SpaceInvaders *si, uint16_t address) {
+  if (get_parity_flag(&si->cpu)) {
+    subroutine_call(si, address);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_call_if_parity_odd(SpaceInvaders *si, uint16_t address) {
+  if (!get_parity_flag(&si->cpu)) {
+    subroutine_call(si, address);
+    return true;
+  }
+  return false;
+}
+
+void subroutine_return(SpaceInvaders *si) {
+  si->cpu.pc = stack_pop_word(si);
+}
+
+bool subroutine_return_if_carry(SpaceInvaders *si) {
+  if (get_carry_flag(&si->cpu)) {
+    subroutine_return(si);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_return_if_no_carry(SpaceInvaders *si) {
+  if (!get_carry_flag(&si->cpu)) {
+    subroutine_return(si);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_return_if_zero(SpaceInvaders *si) {
+  if (get_zero_flag(&si->cpu)) {
+    subroutine_return(si);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_return_if_not_zero(SpaceInvaders *si) {
+  if (!get_zero_flag(&si->cpu)) {
+    subroutine_return(si);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_return_if_minus(SpaceInvaders *si) {
+  if (get_sign_flag(&si->cpu)) {
+    subroutine_return(si);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_return_if_plus(SpaceInvaders *si) {
+  if (!get_sign_flag(&si->cpu)) {
+    subroutine_return(si);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_return_if_parity_even(SpaceInvaders *si) {
+  if (get_parity_flag(&si->cpu)) {
+    subroutine_return(si);
+    return true;
+  }
+  return false;
+}
+
+bool subroutine_return_if_parity_odd(SpaceInvaders *si) {
+  if (!get_parity_flag(&si->cpu)) {
+    subroutine_return(si);
+    return true;
+  }
+  return false;
+}
+
+void no_operation(SpaceInvaders *si) {
+  print_instruction(si, "NOP");
+}
+
+void register_increment(SpaceInvaders *si, enum Register r) {
+  print_instruction(si, "INR %c", register_names[r]);
+  increment_register(&si->cpu, r);
+}
+
+void register_decrement(SpaceInvaders *si, enum Register r) {
+  print_instruction(si, "DCR %c", register_names[r]);
+  decrement_register(&si->cpu, r);
+}
+
+void register_pair_increment(SpaceInvaders *si, enum RegisterPair r) {
+  print_instruction(si, "INX %s", register_pair_names[r]);
+  increment_register_pair(&si->cpu, r);
+}
+
+void register_pair_decrement(SpaceInvaders *si, enum RegisterPair r) {
+  print_instruction(si, "DCX %s", register_pair_names[r]);
+  decrement_register_pair(&si->cpu, r);
+}
+
+void register_move(SpaceInvaders *si, enum Register dst, enum Register src) {
+  print_instruction(si, "MOV %c,%c", register_names[dst], register_names[src]);
+  copy_register(&si->cpu, dst, src);
+}
+
+void restart(SpaceInvaders *si, uint8_t exp) {
+  uint8_t bounded = exp % 8;
+  print_instruction(si, "RST %d", bounded);
+  stack_push_word(si, si->cpu.pc);
+  si->cpu.pc = bounded << 3;
+}
+
+void register_add(SpaceInvaders *si, enum Register r) {
+  print_instruction(si, "ADD %c", register_names[r]);
+  add_register_accumulator(&si->cpu, r);
+}
+
+void register_add_with_carry(SpaceInvaders *si, enum Register r) {
+  print_instruction(si, "ADC %c", register_names[r]);
+  add_register_accumulator_with_carry(&si->cpu, r);
+}
+
+void register_subtract(SpaceInvaders *si, enum Register r) {
+  print_instruction(si, "SUB %c", register_names[r]);
+  subtract_register_accumulator(&si->cpu, r);
+}
+
+void register_subtract_with_borrow(SpaceInvaders *si, enum Register r) {
+  print_instruction(si, "SBB %c", register_names[r]);
+  subtract_register_accumulator_with_borrow(&si->cpu, r);
+}
+
+void register_and(SpaceInvaders *si, enum Register r) {
+  print_instruction(si, "ANA %c", register_names[r]);
+  and_register_accumulator(&si->cpu, r);
+}
+
+void register_or(SpaceInvaders *si, enum Register r) {
+  print_instruction(si, "ORA %c", register_names[r]);
+  or_register_accumulator(&si->cpu, r);
+}
+
+void register_exclusive_or(SpaceInvaders *si, enum Register r) {
+  print_instruction(si, "XRA %c", register_names[r]);
+  exclusive_or_register_accumulator(&si->cpu, r);
+}
+
+void register_compare(SpaceInvaders *si, enum Register r) {
+  print_instruction(si, "CMP %c", register_names[r]);
+  compare_register_accumulator(&si->cpu, r);
+}
+
+// Dispatch engines, selected with the DISPATCH CMake option. All of them
+// expand the same instruction bodies from instructions.h:
+// - switch: a 256-case switch
+// - table: a 256-entry table of instruction handlers
+// - goto: a threaded interpreter jumping straight from one instruction body
+//   to the next through a table of label addresses (GCC/Clang only)
+// - block: goto over basic blocks of the ROM decoded once (GCC/Clang only)
+#if !defined(DISPATCH_SWITCH) && !defined(DISPATCH_TABLE) && !defined(DISPATCH_GOTO) && !defined(DISPATCH_BLOCK)
+#define DISPATCH_SWITCH
+#endif
+
+const char *dispatch_engine(void) {
+#if defined(DISPATCH_TABLE)
+  return "table";
+#elif defined(DISPATCH_GOTO)
+  return "goto";
+#elif defined(DISPATCH_BLOCK)
+  return "block";
+#else
+  return "switch";
+#endif
+}
+
+#define instruction_cycles(opcode, taken) (taken ? opcodes[opcode].cycles_taken : opcodes[opcode].cycles)
+
+#if defined(DISPATCH_TABLE)
+typedef bool (*InstructionHandler)(SpaceInvaders *si);
+
+#define INSTRUCTION(opcode, ...) \
+  static bool instruction_##opcode(SpaceInvaders *si) { \
+    bool taken = false; \
+    __VA_ARGS__ \
+    return taken; \
+  }
+#include "instructions.h"
+#undef INSTRUCTION
+
+#define INSTRUCTION(opcode, ...) [opcode] = instruction_##opcode,
+static const InstructionHandler instructions[256] = {
+#include "instructions.h"
+};
+#undef INSTRUCTION
+#endif
+
+// Executes one instruction, returns the T-states it took
+int cycle(SpaceInvaders *si) {
+#if defined(DISPATCH_GOTO) || defined(DISPATCH_BLOCK)
+  return run_cycles(si, 1);
+#else
+  if (TRACE_LEVEL > TRACE_OFF) {
+    trace_cycle_begin(si);
+  }
+  uint8_t opcode = fetch_opcode(si);
+#if defined(DISPATCH_TABLE)
+  bool taken = instructions[opcode](si);
+#else
+  bool taken = false; // conditional CALL/RET
+  switch (opcode) {
+#define INSTRUCTION(opcode, ...) case opcode: __VA_ARGS__ break;
+#include "instructions.h"
+#undef INSTRUCTION
+  }
+#endif
+  if (TRACE_LEVEL > TRACE_OFF) {
+    trace_cycle_end(si);
+  }
+  si->instructions++;
+  return instruction_cycles(opcode, taken);
+#endif
+}
+
+// Executes instructions until at least budget T-states ran or the CPU halts,
+// returns the T-states it took
+#if defined(DISPATCH_GOTO)
+int run_cycles(SpaceInvaders *si, int budget) {
+#elif defined(DISPATCH_BLOCK)
+// The block engine's path for machines without a ROM (CP/M) and checked builds
+static int run_threaded(SpaceInvaders *si, int budget) {
+#endif
+#if defined(DISPATCH_GOTO) || defined(DISPATCH_BLOCK)
+#define INSTRUCTION(opcode, ...) [opcode] = &&instruction_##opcode,
+  static void *labels[256] = {
+#include "instructions.h"
+  };
+#undef INSTRUCTION
+
+  int cycles = 0;
+  uint8_t opcode;
+  bool taken;
+
+#define DISPATCH() \
+  do { \
+    if (TRACE_LEVEL > TRACE_OFF) { \
+      trace_cycle_begin(si); \
+    } \
+    opcode = fetch_opcode(si); \
+    taken = false; \
+    goto *labels[opcode]; \
+  } while (0)
+
+  if (waiting_for_interrupt(&si->cpu)) {
+    return 0;
+  }
+  DISPATCH();
+
+#define INSTRUCTION(opcode, ...) \
+  instruction_##opcode: \
+    __VA_ARGS__ \
+    if (TRACE_LEVEL > TRACE_OFF) { \
+      trace_cycle_end(si); \
+    } \
+    si->instructions++; \
+    cycles += instruction_cycles(opcode, taken); \
+    if (cycles >= budget || si->cpu.stopped) { \
+      return cycles; \
+    } \
+    DISPATCH();
+#include "instructions.h"
+#undef INSTRUCTION
+#undef DISPATCH
+}
+#endif
+
+#if defined(DISPATCH_BLOCK)
+// The ROM only changes when it is reprogrammed, so each of its addresses is
+// decoded once per ROM image into the label of the instruction body and the
+// basic block starting there: the instructions up to the next one that jumps, calls, returns, halts or
+// enables interrupts, and their T-states. A block whose T-states fit in the
+// budget runs with them counted upfront and without the per instruction
+// interrupt, budget and halt checks. The operands are still fetched by the
+// bodies: with the unchecked bus that is a masked load from the ROM, cheaper
+// than carrying them from the decoded block. Code in RAM and interrupts run
+// one instruction at a time, so RAM writes have nothing to invalidate; an
+// instance follows a reprogrammed ROM through the memory's ROM hash.
+#define BLOCK_MAX_INSTRUCTIONS 64
+
+typedef struct decodedInstruction {
+  int32_t label;    // instruction body, as an offset from the undecoded path
+  uint16_t cycles;  // T-states of the block before its last instruction, the
+                    // only one that can be a conditional CALL / RET
+  uint8_t length;   // instructions in the block
+} DecodedInstruction;
+
+struct decodedRom {
+  struct decodedRom *next;
+  uint16_t rom_size;
+  uint32_t rom_hash;
+  uint8_t *rom;
+  DecodedInstruction instructions[];
+};
+
+// Decoded ROMs, shared by the instances holding the same ROM and kept until
+// exit
+static struct decodedRom *decoded_roms;
+static pthread_mutex_t decoded_roms_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool ends_block(uint8_t opcode) {
+  if (opcode == 0x76 || opcode == 0xfb) { // HLT, EI
+    return true;
+  }
+  if (opcode < 0xc0) {
+    return false;
+  }
+  switch (opcode & 7) {
+    case 0: case 2: case 4: case 7: // Rcc, Jcc, Ccc, RST
+      return true;
+    case 1: // RET, PCHL
+      return opcode == 0xc9 || opcode == 0xd9 || opcode == 0xe9;
+    case 3: // JMP
+      return opcode == 0xc3 || opcode == 0xcb;
+    case 5: // CALL
+      return opcode >= 0xcd && (opcode & 0xf) == 0xd;
+    default:
+      return false;
+  }
+}
+
+static struct decodedRom *decode_rom(Memory *memory, void *const labels[256], void *undecoded) {
+  int rom_size = memory->rom_size;
+  struct decodedRom *decoded = calloc(1, sizeof(struct decodedRom) + rom_size * sizeof(DecodedInstruction));
+  decoded->rom_size = rom_size;
+  decoded->rom_hash = memory->rom_hash;
+  decoded->rom = malloc(rom_size);
+  memcpy(decoded->rom, memory->bytes, rom_size);
+  const uint8_t *rom = decoded->rom;
+  for (int address = 0; address < rom_size; address++) {
+    DecodedInstruction *instruction = &decoded->instructions[address];
+    instruction->label = (char *) labels[rom[address]] - (char *) undecoded;
+    int last = 0;
+    for (int next = address; instruction->length < BLOCK_MAX_INSTRUCTIONS && next < rom_size; ) {
+      uint8_t opcode = rom[next];
+      instruction->cycles += last;
+      instruction->length++;
+      if (ends_block(opcode)) {
+        break;
+      }
+      last = opcodes[opcode].cycles;
+      next += opcodes[opcode].size;
+    }
+  }
+  return decoded;
+}
+
+static const struct decodedRom *decoded_rom(Memory *memory, void *const labels[256], void *undecoded) {
+  pthread_mutex_lock(&decoded_roms_lock);
+  struct decodedRom *decoded = decoded_roms;
+  while (decoded != NULL
+      && (decoded->rom_size != memory->rom_size || decoded->rom_hash != memory->rom_hash
+        || memcmp(decoded->rom, memory->bytes, decoded->rom_size) != 0)) {
+    decoded = decoded->next;
+  }
+  if (decoded == NULL) {
+    decoded = decode_rom(memory, labels, undecoded);
+    decoded->next = decoded_roms;
+    decoded_roms = decoded;
+  }
+  pthread_mutex_unlock(&decoded_roms_lock);
+  return decoded;
+}
+
+int run_cycles(SpaceInvaders *si, int budget) {
+#define INSTRUCTION(opcode, ...) [opcode] = &&instruction_##opcode,
+  static void *const labels[256] = {
+#include "instructions.h"
+  };
+#undef INSTRUCTION
+
+  if (CHECKED_BUS || si->memory.rom_size == 0) {
+    return run_threaded(si, budget);
+  }
+  if (waiting_for_interrupt(&si->cpu)) {
+    return 0;
+  }
+  if (si->decoded == NULL || si->decoded->rom_size != si->memory.rom_size
+      || si->decoded->rom_hash != si->memory.rom_hash) {
+    si->decoded = decoded_rom(&si->memory, labels, &&undecoded);
+  }
+  const DecodedInstruction *decoded = si->decoded->instructions;
+  uint16_t rom_size = si->decoded->rom_size;
+  int cycles = 0;
+  bool taken;
+  int remaining;  // instructions left in the current block
+
+#define NEXT_IN_BLOCK() \
+  do { \
+    const DecodedInstruction *instruction = &decoded[si->cpu.pc++]; \
+    taken = false; \
+    goto *(void *) ((char *) &&undecoded + instruction->label); \
+  } while (0)
+
+  // Shared by every block: the interrupt check, then the block at PC or a
+  // single instruction
+dispatch:
+  remaining = 1;
+  if (si->cpu.interrupt_requested | si->cpu.interrupt_delay) {
+    int rst = interrupt_opcode(si);
+    if (rst >= 0) {
+      taken = false;
+      goto *labels[rst];
+    }
+    // only one instruction, the interrupt may be accepted after it
+    if (si->cpu.pc < rom_size) {
+      NEXT_IN_BLOCK();
+    }
+    goto undecoded;
+  }
+  if (si->cpu.pc < rom_size) {
+    // the budget can only run out on the last instruction of the block
+    const DecodedInstruction *block = &decoded[si->cpu.pc];
+    if (cycles + block->cycles < budget) {
+      remaining = block->length;
+      cycles += block->cycles;
+      si->instructions += remaining - 1;
+    }
+    NEXT_IN_BLOCK();
+  }
+undecoded:
+  taken = false;
+  goto *labels[fetch_byte(si)];
+
+#define INSTRUCTION(opcode, ...) \
+  instruction_##opcode: \
+    __VA_ARGS__ \
+    if (--remaining > 0) { \
+      NEXT_IN_BLOCK(); \
+    } \
+    si->instructions++; \
+    cycles += instruction_cycles(opcode, taken); \
+    if (cycles >= budget || si->cpu.stopped) { \
+      return cycles; \
+    } \
+    goto dispatch;
+#include "instructions.h"
+#undef INSTRUCTION
+#undef NEXT_IN_BLOCK
+}
+#elif !defined(DISPATCH_GOTO)
+int run_cycles(SpaceInvaders *si, int budget) {
+  if (waiting_for_interrupt(&si->cpu)) {
+    return 0;
+  }
+  int cycles = 0;
+  do {
+    cycles += cycle(si);
+  } while (cycles < budget && !si->cpu.stopped);
+  return cycles;
+}
+#endif
+
+// Runs the CPU up to T-state target of the current frame. After HLT it
+// idles until then, the next interrupt wakes it up.
+void run_until(SpaceInvaders *si, int target) {
+  while (si->frame_cycles < target) {
+    int budget = target - si->frame_cycles;
+    int cycles = run_cycles(si, budget);
+    if (si->cpu.stopped) {
+      cycles = budget;
+    }
+    si->frame_cycles += cycles;
+    si->cycles += cycles;
+  }
+}
+
+// Runs a frame worth of CPU time with its two video interrupts, carrying the
+// overshoot of the last instruction into the next frame so the long term rate
+// is exact
+void run_frame(SpaceInvaders *si) {
+  inputs_next_frame(&si->inputs);
+  run_until(si, scanline_cycles(MID_SCREEN_SCANLINE));
+  request_interrupt(&si->cpu, MID_SCREEN_INTERRUPT);
+  run_until(si, scanline_cycles(VBLANK_SCANLINE));
+  request_interrupt(&si->cpu, VBLANK_INTERRUPT);
+  run_until(si, CYCLES_PER_FRAME);
+  si->frame_cycles -= CYCLES_PER_FRAME;
+  si->frames++;
+}
+
+double monotonic_time(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "input.h"
+#include "ports.h"
+#include "space_invaders.h"
+#include "trace.h"
+
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#define CLOCK_HZ 2000000
+#define FRAMES_PER_SECOND 60
+#define CYCLES_PER_FRAME (CLOCK_HZ / FRAMES_PER_SECOND) // 33,333
+
+#define SCANLINES 262
+// The video hardware raises RST 1 when the beam reaches the middle of the
+// screen and RST 2 when it enters VBLANK
+#define MID_SCREEN_SCANLINE 96
+#define VBLANK_SCANLINE 224
+#define scanline_cycles(line) (CYCLES_PER_FRAME * (line) / SCANLINES)
+#define MID_SCREEN_INTERRUPT 1
+#define VBLANK_INTERRUPT 2
+
+// The Space Invaders board: CPU, memory and I/O devices. Nothing here depends
+// on a display, so it builds into spaceinvaders_core for headless use.
+typedef struct spaceInvaders {
+  I8080 cpu;
+  Memory memory;
+  // TODO: extract buses
+  bool write;
+  uint8_t data;
+  uint16_t address;
+  uint64_t cycles;  // T-states since power on
+  uint64_t instructions;
+  uint64_t frames;
+  int frame_cycles; // T-states into the current frame
+  Ports ports;
+  ShiftRegister shifter;
+  Inputs inputs;
+  Trace trace;
+  const struct decodedRom *decoded; // block dispatch: the ROM's decoded blocks
+  bool quiet;       // ROM and save state loads fail without printing why
+} SpaceInvaders;
+
+SpaceInvaders *space_invaders_new(void);
+void space_invaders_free(SpaceInvaders *si);
+void load_rom(SpaceInvaders *si, int address, char *filename);
+// The four ROM files from roms/, exits if one is missing
+void program_rom(SpaceInvaders *si);
+// Same from another directory, false if a file is missing
+bool program_rom_directory(SpaceInvaders *si, const char *directory);
+void program_hardcoded(SpaceInvaders *si);
+int cycle(SpaceInvaders *si);
+int run_cycles(SpaceInvaders *si, int budget);
+void run_frame(SpaceInvaders *si);
+const char *dispatch_engine(void);
+
+double monotonic_time(void);
+
+#endif //MACHINE_H
@@ -6,25 +6,63 @@
 
 #include "space_invaders.h"
 
-void check_bounds(int address) {
-    if (address < 0 || address >= MEMORY_BYTES) {
+void check_bounds(Memory *memory, int address) {
+    if (address < 0 || address > memory->address_mask) {
       printf("Error: address %x out of bounds\n", address);
       exit(1);
     }
 }
 
-void check_bounds_range(int address, int size) {
-  check_bounds(address);
-  check_bounds(address + size - 1);
+void check_bounds_range(Memory *memory, int address, int size) {
+  check_bounds(memory, address);
+  check_bounds(memory, address + size - 1);
+}
+
+static void hash_rom(Memory *memory) {
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < memory->rom_size; i++) {
+    hash = (hash ^ memory->bytes[i]) * 16777619u;
+  }
+  memory->rom_hash = hash;
+}
+
+// Maps size bytes of memory, a power of two, the first rom_size read-only.
+// The game's 16 KB are the board array, a larger map is allocated until
+// memory_free, so instances do not all carry CP/M's 64 KB.
+void memory_init(Memory *memory, int size, int rom_size) {
+  memory_free(memory);
+  if (size > (int) sizeof(memory->board)) {
+    memory->bytes = calloc(size, 1);
+    if (memory->bytes == NULL) {
+      printf("Error: out of memory for a %d byte map\n", size);
+      exit(1);
+    }
+  }
+  memory->address_mask = size - 1;
+  memory->rom_size = rom_size;
+  hash_rom(memory);
+}
+
+void memory_free(Memory *memory) {
+  if (memory->bytes != memory->board) {
+    free(memory->bytes);
+  }
+  memory->bytes = memory->board;
 }
 
 void memory_write(Memory *memory, uint8_t bytes[], int address, int size) {
-  check_bounds_range(address, size);
+  check_bounds_range(memory, address, size);
   memcpy(memory->bytes + address, bytes, size);
+  if (address < memory->rom_size) {
+    hash_rom(memory);
+  }
+  if (address + size > VRAM_ADDRESS && address < VRAM_ADDRESS + VRAM_SIZE) {
+    memory_mark_vram_dirty(memory);
+  }
 }
 
 void memory_peek(Memory *memory, int address, int size) {
-  check_bounds_range(address, size);
+  check_bounds_range(memory, address, size);
   for (int i = address; i < address + size; i++) {
     if (i % 16 == 0) {
       printf("%04x", i);
@@ -40,7 +78,7 @@ void memory_peek(Memory *memory, int address, int size) {
 }
 
 void memory_peek_highlight(Memory *memory, int address, int size, int highlight) {
-  check_bounds_range(address, size);
+  check_bounds_range(memory, address, size);
   int to = address + size;
   for (int i = address; i < address + size; i++) {
     if (i % 16 == 0) {
@@ -61,15 +99,95 @@ void memory_peek_highlight(Memory *memory, int address, int size, int highlight)
 }
 
 void memory_dump(Memory *memory) {
-  memory_peek(memory, 0, MEMORY_BYTES);
+  memory_peek(memory, 0, memory->address_mask + 1);
+}
+
+void memory_clear_vram_dirty(Memory *memory) {
+  VramDirty *dirty = &memory->vram_dirty;
+  dirty->columns = 0;
+  dirty->bytes = 0;
+  dirty->writes = 0;
+  memset(dirty->map, 0, sizeof(dirty->map));
+}
+
+// Marks the whole screen for redraw, e.g. after loading memory in bulk
+void memory_mark_vram_dirty(Memory *memory) {
+  VramDirty *dirty = &memory->vram_dirty;
+  dirty->columns = 0xffffffff;
+  memset(dirty->from, 0, sizeof(dirty->from));
+  memset(dirty->to, VRAM_LINES - 1, sizeof(dirty->to));
+}
+
+// Adds the changes recorded in from, e.g. of a frame that was never drawn
+void vram_dirty_merge(VramDirty *into, const VramDirty *from) {
+  for (int column = 0; column < VRAM_LINE_BYTES; column++) {
+    if (!(from->columns >> column & 1)) {
+      continue;
+    }
+    if (!(into->columns >> column & 1)) {
+      into->from[column] = from->from[column];
+      into->to[column] = from->to[column];
+    } else {
+      if (from->from[column] < into->from[column]) {
+        into->from[column] = from->from[column];
+      }
+      if (from->to[column] > into->to[column]) {
+        into->to[column] = from->to[column];
+      }
+    }
+  }
+  into->columns |= from->columns;
+
+  for (int i = 0; i < VRAM_SIZE / 8; i++) {
+    uint8_t added = from->map[i] & ~into->map[i];
+    into->map[i] |= added;
+    for (; added; added >>= 1) {
+      into->bytes += added & 1;
+    }
+  }
+  into->writes += from->writes;
+}
+
+void vram_write_byte(Memory *memory, uint16_t address, uint8_t data) {
+  VramDirty *dirty = &memory->vram_dirty;
+  dirty->writes++;
+  if (memory->bytes[address] == data) {
+    return;
+  }
+
+  int offset = address - VRAM_ADDRESS;
+  uint8_t bit = 1 << (offset % 8);
+  if (dirty->map[offset / 8] & bit) {
+    return;
+  }
+  dirty->map[offset / 8] |= bit;
+  dirty->bytes++;
+
+  int line = offset / VRAM_LINE_BYTES;
+  int column = offset % VRAM_LINE_BYTES;
+  if (!(dirty->columns >> column & 1)) {
+    dirty->columns |= 1u << column;
+    dirty->from[column] = line;
+    dirty->to[column] = line;
+  } else if (line < dirty->from[column]) {
+    dirty->from[column] = line;
+  } else if (line > dirty->to[column]) {
+    dirty->to[column] = line;
+  }
 }
 
 void memory_write_byte(Memory *memory, uint16_t address, uint8_t data) {
-  check_bounds(address);
+  check_bounds(memory, address);
+  if (address < memory->rom_size) {
+    return;
+  }
+  if (is_vram_address(address)) {
+    vram_write_byte(memory, address, data);
+  }
   memory->bytes[address] = data;
 }
 
 uint8_t memory_read_byte(Memory *memory, uint16_t address) {
-  check_bounds(address);
+  check_bounds(memory, address);
   return memory->bytes[address];
 }
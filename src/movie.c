@@ -0,0 +1,117 @@
+#include "movie.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "input.h"
+#include "savestate.h"
+
+// FNV-1a over 64 bit words, folded to 32 bits: cheap enough to run after
+// every frame of a replay
+uint32_t movie_ram_hash(Memory *memory) {
+  uint64_t hash = 14695981039346656037u;
+  int size = memory->address_mask + 1;
+  for (int address = memory->rom_size; address + 8 <= size; address += 8) {
+    uint64_t word;
+    memcpy(&word, &memory->bytes[address], sizeof(word));
+    hash = (hash ^ word) * 1099511628211u;
+  }
+  return hash ^ hash >> 32;
+}
+
+void movie_record_start(Movie *movie, SpaceInvaders *si) {
+  *movie = (Movie) { 0 };
+  movie->state_size = savestate_size(si);
+  movie->state = malloc(movie->state_size);
+  savestate_save(si, movie->state);
+}
+
+void movie_record_frame(Movie *movie, SpaceInvaders *si) {
+  if (movie->count == movie->capacity) {
+    movie->capacity = movie->capacity ? movie->capacity * 2 : 60 * FRAMES_PER_SECOND;
+    movie->frames = realloc(movie->frames, movie->capacity * sizeof(MovieFrame));
+    if (movie->frames == NULL) {
+      printf("Error: out of memory for the movie\n");
+      exit(1);
+    }
+  }
+  movie->frames[movie->count++] = (MovieFrame) {
+    .buttons = si->inputs.buttons,
+    .ram_hash = movie_ram_hash(&si->memory),
+  };
+}
+
+bool movie_write_file(Movie *movie, const char *filename) {
+  MovieHeader header = { MOVIE_MAGIC, MOVIE_VERSION, movie->state_size, movie->count, 0 };
+  FILE *f = fopen(filename, "wb");
+  bool written = f != NULL
+    && fwrite(&header, sizeof(header), 1, f) == 1
+    && fwrite(movie->state, movie->state_size, 1, f) == 1
+    && fwrite(movie->frames, sizeof(MovieFrame), movie->count, f) == movie->count;
+  if (f != NULL) {
+    written = fclose(f) == 0 && written;
+  }
+  if (!written) {
+    printf("Error: unable to write movie %s\n", filename);
+  }
+  return written;
+}
+
+bool movie_read_file(Movie *movie, const char *filename) {
+  *movie = (Movie) { 0 };
+  FILE *f = fopen(filename, "rb");
+  if (f == NULL) {
+    printf("Error: unable to open movie %s\n", filename);
+    return false;
+  }
+  MovieHeader header;
+  if (fread(&header, sizeof(header), 1, f) != 1
+      || memcmp(header.magic, MOVIE_MAGIC, sizeof(header.magic)) != 0
+      || header.version != MOVIE_VERSION) {
+    printf("Error: %s is not a version %d movie\n", filename, MOVIE_VERSION);
+    fclose(f);
+    return false;
+  }
+
+  movie->state_size = header.state_size;
+  movie->count = movie->capacity = header.frames;
+  movie->state = malloc(movie->state_size);
+  movie->frames = malloc(movie->count * sizeof(MovieFrame));
+  bool read = fread(movie->state, movie->state_size, 1, f) == 1
+    && fread(movie->frames, sizeof(MovieFrame), movie->count, f) == movie->count;
+  fclose(f);
+  if (!read) {
+    printf("Error: movie %s truncated\n", filename);
+    movie_free(movie);
+  }
+  return read;
+}
+
+bool movie_replay_start(Movie *movie, SpaceInvaders *si) {
+  return savestate_load(si, movie->state, movie->state_size);
+}
+
+void movie_replay_input(Movie *movie, SpaceInvaders *si, uint32_t frame) {
+  input_queue_push(&si->inputs.queue, movie->frames[frame].buttons);
+}
+
+bool movie_replay_check(Movie *movie, SpaceInvaders *si, uint32_t frame) {
+  uint32_t hash = movie_ram_hash(&si->memory);
+  if (hash != movie->frames[frame].ram_hash) {
+    printf(
+      "Error: replay diverged at movie frame %u: RAM hash %08x, recorded %08x\n",
+      frame, hash, movie->frames[frame].ram_hash
+    );
+    return false;
+  }
+  return true;
+}
+
+void movie_free(Movie *movie) {
+  free(movie->state);
+  free(movie->frames);
+  *movie = (Movie) { 0 };
+}
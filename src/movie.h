@@ -0,0 +1,59 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "machine.h"
+
+#ifndef MOVIE_H
+#define MOVIE_H
+
+// Input movie: the save state a run started from (DIP switches included)
+// followed by the buttons held and a RAM hash for every emulated frame, in
+// host byte order. INP0-INP2 are a function of these, so replaying the
+// buttons from the same state reproduces the run exactly, and the hashes
+// catch the first frame where it doesn't.
+#define MOVIE_MAGIC "I8080MOV"
+#define MOVIE_VERSION 1
+
+typedef struct movieHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t state_size; // save state bytes following the header
+  uint32_t frames;     // MovieFrame records after the state
+  uint32_t reserved;
+} MovieHeader;
+
+typedef struct movieFrame {
+  uint16_t buttons;    // InputButton bits held during the frame
+  uint16_t reserved;
+  uint32_t ram_hash;   // movie_ram_hash at the end of the frame
+} MovieFrame;
+
+_Static_assert(sizeof(MovieHeader) == 24, "movie headers are fixed size");
+_Static_assert(sizeof(MovieFrame) == 8, "movie frames are fixed size");
+
+typedef struct movie {
+  uint8_t *state;
+  uint32_t state_size;
+  MovieFrame *frames;
+  uint32_t count;
+  uint32_t capacity;
+} Movie;
+
+uint32_t movie_ram_hash(Memory *memory);
+
+// Recording: start from the current state, then add each frame once it ran
+void movie_record_start(Movie *movie, SpaceInvaders *si);
+void movie_record_frame(Movie *movie, SpaceInvaders *si);
+bool movie_write_file(Movie *movie, const char *filename);
+
+// Replay: restore the starting state, then feed the buttons before running
+// each frame and check its hash after
+bool movie_read_file(Movie *movie, const char *filename);
+bool movie_replay_start(Movie *movie, SpaceInvaders *si);
+void movie_replay_input(Movie *movie, SpaceInvaders *si, uint32_t frame);
+bool movie_replay_check(Movie *movie, SpaceInvaders *si, uint32_t frame);
+void movie_free(Movie *movie);
+
+#endif //MOVIE_H
@@ -0,0 +1,21 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef OPCODES_H
+#define OPCODES_H
+
+typedef struct opcode {
+  const char *mnemonic; // printf format, immediate operand as %02x or %04x
+  uint8_t size;         // bytes, including the opcode
+  uint8_t cycles;       // T-states, for conditional CALL/RET when not taken
+  uint8_t cycles_taken; // T-states when a conditional CALL/RET is taken
+} Opcode;
+
+extern const Opcode opcodes[256];
+
+// Writes the mnemonic for the instruction starting at bytes[0], formatted
+// exactly as the instruction trace prints it.
+int disassemble(char *buffer, size_t size, const uint8_t bytes[3]);
+
+#endif //OPCODES_H
@@ -0,0 +1,49 @@
+#include "ports.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+static uint8_t unmapped_read(void *device, uint8_t port) {
+  return 0;
+}
+
+static void unmapped_write(void *device, uint8_t port, uint8_t data) {
+}
+
+void ports_init(Ports *ports) {
+  for (int port = 0; port < PORT_COUNT; port++) {
+    ports_map_read(ports, port, unmapped_read, NULL);
+    ports_map_write(ports, port, unmapped_write, NULL);
+  }
+}
+
+void ports_map_read(Ports *ports, uint8_t port, PortRead read, void *device) {
+  ports->read[port] = read;
+  ports->read_device[port] = device;
+}
+
+void ports_map_write(Ports *ports, uint8_t port, PortWrite write, void *device) {
+  ports->write[port] = write;
+  ports->write_device[port] = device;
+}
+
+static uint8_t shift_register_read(void *device, uint8_t port) {
+  ShiftRegister *shifter = device;
+  return shifter->value >> (8 - shifter->offset);
+}
+
+static void shift_register_write_amount(void *device, uint8_t port, uint8_t data) {
+  ShiftRegister *shifter = device;
+  shifter->offset = data & 0x7;
+}
+
+static void shift_register_write_data(void *device, uint8_t port, uint8_t data) {
+  ShiftRegister *shifter = device;
+  shifter->value = data << 8 | shifter->value >> 8;
+}
+
+void shift_register_attach(ShiftRegister *shifter, Ports *ports) {
+  ports_map_read(ports, PORT_SHFT_IN, shift_register_read, shifter);
+  ports_map_write(ports, PORT_SHFTAMNT, shift_register_write_amount, shifter);
+  ports_map_write(ports, PORT_SHFT_DATA, shift_register_write_data, shifter);
+}
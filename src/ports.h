@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+
+#ifndef PORTS_H
+#define PORTS_H
+
+// Space Invaders I/O port map
+#define PORT_INP0 0
+#define PORT_INP1 1
+#define PORT_INP2 2
+#define PORT_SHFT_IN 3
+#define PORT_SHFTAMNT 2
+#define PORT_SOUND1 3
+#define PORT_SHFT_DATA 4
+#define PORT_SOUND2 5
+#define PORT_WATCHDOG 6
+
+#define PORT_COUNT 256
+
+typedef uint8_t (*PortRead)(void *device, uint8_t port);
+typedef void (*PortWrite)(void *device, uint8_t port, uint8_t data);
+
+// Devices attached to the IN / OUT ports, one read and one write callback
+// per port. Unmapped ports read 0 and ignore writes.
+typedef struct ports {
+  PortRead read[PORT_COUNT];
+  void *read_device[PORT_COUNT];
+  PortWrite write[PORT_COUNT];
+  void *write_device[PORT_COUNT];
+} Ports;
+
+void ports_init(Ports *ports);
+void ports_map_read(Ports *ports, uint8_t port, PortRead read, void *device);
+void ports_map_write(Ports *ports, uint8_t port, PortWrite write, void *device);
+
+static inline uint8_t port_read(Ports *ports, uint8_t port) {
+  return ports->read[port](ports->read_device[port], port);
+}
+
+static inline void port_write(Ports *ports, uint8_t port, uint8_t data) {
+  ports->write[port](ports->write_device[port], port, data);
+}
+
+// Dedicated shifter the game draws sprites with: OUT SHFT_DATA pushes a byte
+// into the high half of a 16 bit register, OUT SHFTAMNT sets an offset and
+// IN SHFT_IN reads the 8 bits that many bits below the top.
+typedef struct shiftRegister {
+  uint16_t value;
+  uint8_t offset;
+} ShiftRegister;
+
+void shift_register_attach(ShiftRegister *shifter, Ports *ports);
+
+#endif //PORTS_H
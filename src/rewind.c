@@ -0,0 +1,147 @@
+#include "rewind.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "savestate.h"
+
+static size_t bitmap_bytes(RewindHistory *history) {
+  return (history->pages + 7) / 8;
+}
+
+static void reserve(RewindFrame *frame, size_t size) {
+  if (frame->capacity < size) {
+    frame->data = realloc(frame->data, size);
+    if (frame->data == NULL) {
+      printf("Error: out of memory for the rewind history\n");
+      exit(1);
+    }
+    frame->capacity = size;
+  }
+}
+
+void rewind_init(RewindHistory *history, SpaceInvaders *si, int frames, int keyframe_interval) {
+  *history = (RewindHistory) { 0 };
+  history->capacity = frames;
+  history->frames = calloc(frames, sizeof(RewindFrame));
+  history->keyframe_interval = keyframe_interval;
+  history->state_size = savestate_size(si);
+  history->pages = (history->state_size - sizeof(SaveStateHeader) + REWIND_PAGE_BYTES - 1) / REWIND_PAGE_BYTES;
+  history->state = malloc(history->state_size);
+}
+
+void rewind_free(RewindHistory *history) {
+  for (int i = 0; i < history->capacity; i++) {
+    free(history->frames[i].data);
+  }
+  free(history->frames);
+  free(history->state);
+}
+
+// Stores the pages of the scratch state that differ from the keyframe
+static void store_delta(RewindHistory *history, RewindFrame *frame, RewindFrame *keyframe) {
+  size_t header = sizeof(SaveStateHeader);
+  size_t body = history->state_size - header;
+  reserve(frame, header + bitmap_bytes(history) + body);
+
+  uint8_t *bitmap = frame->data + header;
+  uint8_t *out = bitmap + bitmap_bytes(history);
+  memcpy(frame->data, history->state, header);
+  memset(bitmap, 0, bitmap_bytes(history));
+  for (int page = 0; page < history->pages; page++) {
+    size_t offset = header + page * REWIND_PAGE_BYTES;
+    size_t size = history->state_size - offset < REWIND_PAGE_BYTES ? history->state_size - offset : REWIND_PAGE_BYTES;
+    if (memcmp(history->state + offset, keyframe->data + offset, size) != 0) {
+      bitmap[page / 8] |= 1 << page % 8;
+      memcpy(out, history->state + offset, size);
+      out += size;
+    }
+  }
+  frame->size = out - frame->data;
+}
+
+void rewind_push(RewindHistory *history, SpaceInvaders *si) {
+  savestate_save(si, history->state);
+
+  int slot = history->head;
+  RewindFrame *frame = &history->frames[slot];
+  // a full ring may be about to overwrite the keyframe itself
+  bool keyframe = history->since_keyframe == 0 || slot == history->keyframe_slot;
+  frame->serial = history->serial++;
+  if (keyframe) {
+    reserve(frame, history->state_size);
+    memcpy(frame->data, history->state, history->state_size);
+    frame->size = history->state_size;
+    frame->keyframe = frame->serial;
+    frame->keyframe_slot = slot;
+    frame->since_keyframe = 0;
+    history->keyframe_slot = slot;
+  } else {
+    RewindFrame *key = &history->frames[history->keyframe_slot];
+    store_delta(history, frame, key);
+    frame->keyframe = key->serial;
+    frame->keyframe_slot = history->keyframe_slot;
+    frame->since_keyframe = history->since_keyframe;
+  }
+  history->since_keyframe = (frame->since_keyframe + 1) % history->keyframe_interval;
+
+  history->head = (slot + 1) % history->capacity;
+  if (history->count < history->capacity) {
+    history->count++;
+  }
+}
+
+// Rebuilds the full save state of a frame into the scratch state
+static bool restore_state(RewindHistory *history, RewindFrame *frame) {
+  RewindFrame *key = &history->frames[frame->keyframe_slot];
+  if (key->serial != frame->keyframe) {
+    return false; // overwritten, the frame can't be rebuilt
+  }
+  if (frame == key) {
+    memcpy(history->state, frame->data, history->state_size);
+    return true;
+  }
+
+  size_t header = sizeof(SaveStateHeader);
+  memcpy(history->state, key->data, history->state_size);
+  memcpy(history->state, frame->data, header);
+  uint8_t *bitmap = frame->data + header;
+  uint8_t *in = bitmap + bitmap_bytes(history);
+  for (int page = 0; page < history->pages; page++) {
+    if (bitmap[page / 8] >> page % 8 & 1) {
+      size_t offset = header + page * REWIND_PAGE_BYTES;
+      size_t size = history->state_size - offset < REWIND_PAGE_BYTES ? history->state_size - offset : REWIND_PAGE_BYTES;
+      memcpy(history->state + offset, in, size);
+      in += size;
+    }
+  }
+  return true;
+}
+
+bool rewind_step_back(RewindHistory *history, SpaceInvaders *si) {
+  if (history->count < 2) {
+    return false;
+  }
+  int slot = (history->head - 2 + history->capacity) % history->capacity;
+  RewindFrame *frame = &history->frames[slot];
+  if (!restore_state(history, frame) || !savestate_load(si, history->state, history->state_size)) {
+    return false;
+  }
+
+  history->head = (slot + 1) % history->capacity;
+  history->count--;
+  history->keyframe_slot = frame->keyframe_slot;
+  history->since_keyframe = (frame->since_keyframe + 1) % history->keyframe_interval;
+  return true;
+}
+
+size_t rewind_memory(RewindHistory *history) {
+  size_t bytes = 0;
+  for (int i = 0; i < history->count; i++) {
+    bytes += history->frames[(history->head - 1 - i + history->capacity) % history->capacity].size;
+  }
+  return bytes;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "machine.h"
+
+#ifndef REWIND_H
+#define REWIND_H
+
+// Rewind history: a save state per emulated frame in a ring. Every
+// keyframe_interval frames the whole state is kept, in between only the
+// header and the memory pages that differ from the last keyframe. Pages are
+// small since the game touches scattered bytes of VRAM every frame: during
+// play a frame costs about 1 KB instead of a full 8 KB copy.
+#define REWIND_PAGE_BYTES 8
+
+typedef struct rewindFrame {
+  uint8_t *data;      // save state header, page bitmap, then the stored pages
+  size_t size;
+  size_t capacity;
+  uint64_t serial;    // push count when taken
+  uint64_t keyframe;  // serial of the keyframe it is relative to, its own for keyframes
+  int keyframe_slot;
+  int since_keyframe; // 0 for keyframes
+} RewindFrame;
+
+typedef struct rewindHistory {
+  RewindFrame *frames;
+  int capacity;
+  int head;            // slot of the next frame
+  int count;
+  int keyframe_interval;
+  int since_keyframe;  // frames pushed since the last keyframe
+  int keyframe_slot;
+  uint64_t serial;
+  size_t state_size;   // full save state bytes
+  int pages;           // memory pages after the save state header
+  uint8_t *state;      // scratch save state
+} RewindHistory;
+
+void rewind_init(RewindHistory *history, SpaceInvaders *si, int frames, int keyframe_interval);
+void rewind_free(RewindHistory *history);
+// Records the state after a frame, replacing the oldest one when full
+void rewind_push(RewindHistory *history, SpaceInvaders *si);
+// Drops the latest frame and restores the one before it, false when the
+// history is exhausted
+bool rewind_step_back(RewindHistory *history, SpaceInvaders *si);
+// Bytes held by the stored frames
+size_t rewind_memory(RewindHistory *history);
+
+#endif //REWIND_H
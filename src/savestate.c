@@ -0,0 +1,145 @@
+#include "savestate.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t ram_size(Memory *memory) {
+  return memory->address_mask + 1 - memory->rom_size;
+}
+
+size_t savestate_size(SpaceInvaders *si) {
+  return sizeof(SaveStateHeader) + ram_size(&si->memory);
+}
+
+void savestate_save(SpaceInvaders *si, uint8_t *buffer) {
+  I8080 *cpu = &si->cpu;
+  Memory *memory = &si->memory;
+  SaveStateHeader header = {
+    .magic = SAVESTATE_MAGIC,
+    .version = SAVESTATE_VERSION,
+    .ram_size = ram_size(memory),
+    .cycles = si->cycles,
+    .instructions = si->instructions,
+    .frames = si->frames,
+    .frame_cycles = si->frame_cycles,
+    .rom_hash = memory->rom_hash,
+    .pc = cpu->pc,
+    .sp = cpu->sp,
+    .address_mask = memory->address_mask,
+    .rom_size = memory->rom_size,
+    .shift_value = si->shifter.value,
+    .buttons = si->inputs.buttons,
+    .cpu_flags = (cpu->interrupt_enabled ? SAVESTATE_INTERRUPT_ENABLED : 0)
+      | (cpu->interrupt_delay ? SAVESTATE_INTERRUPT_DELAY : 0)
+      | (cpu->interrupt_requested ? SAVESTATE_INTERRUPT_REQUESTED : 0)
+      | (cpu->stopped ? SAVESTATE_STOPPED : 0),
+    .interrupt_vector = cpu->interrupt_vector,
+    .shift_offset = si->shifter.offset,
+    .lives = si->inputs.dip.lives,
+    .dip_flags = (si->inputs.dip.extra_life_early ? SAVESTATE_EXTRA_LIFE_EARLY : 0)
+      | (si->inputs.dip.coin_info ? SAVESTATE_COIN_INFO : 0),
+  };
+  memcpy(header.registers, cpu->registers, REGISTER_COUNT);
+
+  memcpy(buffer, &header, sizeof(header));
+  memcpy(buffer + sizeof(header), &memory->bytes[memory->rom_size], header.ram_size);
+}
+
+// Refuses a state, printing why unless si is quiet
+static bool refuse(SpaceInvaders *si, const char *format, ...) {
+  if (!si->quiet) {
+    va_list arguments;
+    va_start(arguments, format);
+    printf("Error: ");
+    vprintf(format, arguments);
+    printf("\n");
+    va_end(arguments);
+  }
+  return false;
+}
+
+bool savestate_load(SpaceInvaders *si, const uint8_t *buffer, size_t size) {
+  I8080 *cpu = &si->cpu;
+  Memory *memory = &si->memory;
+  SaveStateHeader header;
+  if (size < sizeof(header)) {
+    return refuse(si, "save state truncated");
+  }
+  memcpy(&header, buffer, sizeof(header));
+  if (memcmp(header.magic, SAVESTATE_MAGIC, sizeof(header.magic)) != 0 || header.version != SAVESTATE_VERSION) {
+    return refuse(si, "not a version %d save state", SAVESTATE_VERSION);
+  }
+  if (header.address_mask != memory->address_mask || header.rom_size != memory->rom_size
+      || header.ram_size != ram_size(memory)) {
+    return refuse(si, "save state is for another memory map");
+  }
+  if (size != sizeof(header) + header.ram_size) {
+    return refuse(si, "save state truncated");
+  }
+  if (header.rom_hash != memory->rom_hash) {
+    return refuse(si, "save state was made with another ROM");
+  }
+
+  memcpy(cpu->registers, header.registers, REGISTER_COUNT);
+  cpu->pc = header.pc;
+  cpu->sp = header.sp;
+  cpu->interrupt_enabled = header.cpu_flags & SAVESTATE_INTERRUPT_ENABLED;
+  cpu->interrupt_delay = header.cpu_flags & SAVESTATE_INTERRUPT_DELAY;
+  cpu->interrupt_requested = header.cpu_flags & SAVESTATE_INTERRUPT_REQUESTED;
+  cpu->stopped = header.cpu_flags & SAVESTATE_STOPPED;
+  cpu->interrupt_vector = header.interrupt_vector;
+
+  memcpy(&memory->bytes[memory->rom_size], buffer + sizeof(header), header.ram_size);
+  memory_mark_vram_dirty(memory);
+
+  si->shifter.value = header.shift_value;
+  si->shifter.offset = header.shift_offset;
+  si->inputs.buttons = header.buttons;
+  si->inputs.dip.lives = header.lives;
+  si->inputs.dip.extra_life_early = header.dip_flags & SAVESTATE_EXTRA_LIFE_EARLY;
+  si->inputs.dip.coin_info = header.dip_flags & SAVESTATE_COIN_INFO;
+
+  si->cycles = header.cycles;
+  si->instructions = header.instructions;
+  si->frames = header.frames;
+  si->frame_cycles = header.frame_cycles;
+  return true;
+}
+
+bool savestate_write_file(SpaceInvaders *si, const char *filename) {
+  size_t size = savestate_size(si);
+  uint8_t *buffer = malloc(size);
+  savestate_save(si, buffer);
+
+  FILE *f = fopen(filename, "wb");
+  bool written = f != NULL && fwrite(buffer, size, 1, f) == 1;
+  if (f != NULL) {
+    written = fclose(f) == 0 && written;
+  }
+  free(buffer);
+  if (!written) {
+    printf("Error: unable to write save state %s\n", filename);
+  }
+  return written;
+}
+
+bool savestate_read_file(SpaceInvaders *si, const char *filename) {
+  FILE *f = fopen(filename, "rb");
+  if (f == NULL) {
+    printf("Error: unable to open save state %s\n", filename);
+    return false;
+  }
+  // one byte more than a valid state to notice trailing data
+  size_t capacity = savestate_size(si) + 1;
+  uint8_t *buffer = malloc(capacity);
+  size_t size = fread(buffer, 1, capacity, f);
+  fclose(f);
+
+  bool loaded = savestate_load(si, buffer, size);
+  free(buffer);
+  return loaded;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "machine.h"
+
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+// Save state: a fixed header with the CPU, device and clock state followed by
+// the writable memory, in host byte order like the binary traces. The ROM is
+// not stored, only its hash, so a state loads into a machine set up the same
+// way (program_rom, cpm_load) and is refused otherwise.
+#define SAVESTATE_MAGIC "I8080SAV"
+#define SAVESTATE_VERSION 1
+#define SAVESTATE_INTERRUPT_ENABLED 1
+#define SAVESTATE_INTERRUPT_DELAY 2
+#define SAVESTATE_INTERRUPT_REQUESTED 4
+#define SAVESTATE_STOPPED 8
+#define SAVESTATE_EXTRA_LIFE_EARLY 1
+#define SAVESTATE_COIN_INFO 2
+
+typedef struct saveStateHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t ram_size;         // memory bytes following the header
+  uint64_t cycles;
+  uint64_t instructions;
+  uint64_t frames;
+  int32_t frame_cycles;
+  uint32_t rom_hash;         // FNV-1a of the ROM the state was saved with
+  uint16_t pc;
+  uint16_t sp;
+  uint16_t address_mask;
+  uint16_t rom_size;
+  uint16_t shift_value;
+  uint16_t buttons;
+  uint8_t registers[REGISTER_COUNT];
+  uint8_t cpu_flags;         // SAVESTATE_INTERRUPT_* | SAVESTATE_STOPPED
+  uint8_t interrupt_vector;
+  uint8_t shift_offset;
+  uint8_t lives;
+  uint8_t dip_flags;         // SAVESTATE_EXTRA_LIFE_EARLY | SAVESTATE_COIN_INFO
+  uint8_t reserved[7];
+} SaveStateHeader;
+
+_Static_assert(sizeof(SaveStateHeader) == 80, "save state headers are fixed size");
+
+// Bytes savestate_save writes for the current memory map
+size_t savestate_size(SpaceInvaders *si);
+void savestate_save(SpaceInvaders *si, uint8_t *buffer);
+// Restores a state unless it is malformed or was saved with another ROM or
+// memory map, printing why
+bool savestate_load(SpaceInvaders *si, const uint8_t *buffer, size_t size);
+bool savestate_write_file(SpaceInvaders *si, const char *filename);
+bool savestate_read_file(SpaceInvaders *si, const char *filename);
+
+#endif //SAVESTATE_H
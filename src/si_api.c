@@ -0,0 +1,200 @@
+#include "si_api.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "batch.h"
+#include "machine.h"
+#include "savestate.h"
+
+// Game variables, see the Space Invaders disassembly in the README resources
+#define GAME_MODE_ADDRESS 0x20ef   // 1 while a game is played
+#define P1_SCORE_ADDRESS 0x20f8    // BCD, low two digits first
+#define P1_SHIPS_ADDRESS 0x21ff    // ships left besides the one in play
+
+// Boot script to the start of a game: the attract mode takes coins from
+// about frame 200, the ships are set up a few frames after the start button
+#define START_COIN_FRAME 200
+#define START_BUTTON_FRAME 260
+#define START_PRESS_FRAMES 5
+#define START_TIMEOUT_FRAMES 600
+
+struct siEnv {
+  SpaceInvaders *si;
+  uint8_t *start;     // save state si_reset goes back to
+  size_t state_size;
+};
+
+static const uint16_t action_buttons[SI_ACTION_COUNT] = {
+  [SI_NOOP] = 0,
+  [SI_FIRE] = INPUT_P1_FIRE,
+  [SI_RIGHT] = INPUT_P1_RIGHT,
+  [SI_LEFT] = INPUT_P1_LEFT,
+  [SI_RIGHT_FIRE] = INPUT_P1_RIGHT | INPUT_P1_FIRE,
+  [SI_LEFT_FIRE] = INPUT_P1_LEFT | INPUT_P1_FIRE,
+};
+
+static void press(SpaceInvaders *si, uint16_t buttons) {
+  input_queue_push(&si->inputs.queue, buttons);
+}
+
+static uint16_t buttons(int action) {
+  return action >= 0 && action < SI_ACTION_COUNT ? action_buttons[action] : 0;
+}
+
+static int bcd(uint8_t value) {
+  return (value >> 4) * 10 + (value & 0xf);
+}
+
+int si_api_version(void) {
+  return SI_API_VERSION;
+}
+
+SiEnv *si_create(const char *rom_directory, int lives) {
+  if (lives != 0 && (lives < 3 || lives > 6)) {
+    return NULL;
+  }
+  SpaceInvaders *si = space_invaders_new();
+  // errors reach the caller as NULL / false, never on its stdout
+  si->quiet = true;
+  if (!program_rom_directory(si, rom_directory)) {
+    space_invaders_free(si);
+    return NULL;
+  }
+  if (lives != 0) {
+    si->inputs.dip.lives = lives;
+  }
+
+  const uint8_t *ram = si->memory.bytes;
+  int frame = 0;
+  for (; frame < START_TIMEOUT_FRAMES; frame++) {
+    if (frame >= START_COIN_FRAME && frame < START_COIN_FRAME + START_PRESS_FRAMES) {
+      press(si, INPUT_COIN);
+    } else if (frame >= START_BUTTON_FRAME && frame < START_BUTTON_FRAME + START_PRESS_FRAMES) {
+      press(si, INPUT_P1_START);
+    }
+    run_frame(si);
+    if (ram[GAME_MODE_ADDRESS] != 0 && ram[P1_SHIPS_ADDRESS] != 0) {
+      break;
+    }
+  }
+  if (frame == START_TIMEOUT_FRAMES) {
+    space_invaders_free(si);
+    return NULL;
+  }
+
+  SiEnv *env = malloc(sizeof(SiEnv));
+  env->si = si;
+  env->state_size = savestate_size(si);
+  env->start = malloc(env->state_size);
+  savestate_save(si, env->start);
+  return env;
+}
+
+void si_destroy(SiEnv *env) {
+  if (env == NULL) {
+    return;
+  }
+  space_invaders_free(env->si);
+  free(env->start);
+  free(env);
+}
+
+void si_reset(SiEnv *env) {
+  savestate_load(env->si, env->start, env->state_size);
+}
+
+bool si_game_over(SiEnv *env) {
+  return env->si->memory.bytes[GAME_MODE_ADDRESS] == 0;
+}
+
+// Points between two scores, the counter wraps at 10000
+static int points(int before, int after) {
+  return after >= before ? after - before : after + 10000 - before;
+}
+
+int si_step(SiEnv *env, int action, int frames) {
+  int score = si_get_score(env);
+  for (int frame = 0; frame < frames && !si_game_over(env); frame++) {
+    press(env->si, buttons(action));
+    run_frame(env->si);
+  }
+  return points(score, si_get_score(env));
+}
+
+// Batch instance i runs envs[index[i]]
+typedef struct stepBatch {
+  SiEnv **envs;
+  const int *actions;
+  int *index;
+} StepBatch;
+
+static void step_input(SpaceInvaders *si, int instance, uint32_t frame, void *context) {
+  StepBatch *step = context;
+  press(si, buttons(step->actions[step->index[instance]]));
+}
+
+static bool step_running(SpaceInvaders *si, int instance, uint32_t frame, void *context) {
+  StepBatch *step = context;
+  return !si_game_over(step->envs[step->index[instance]]);
+}
+
+void si_step_batch(SiEnv **envs, int count, const int *actions, int frames, int *rewards, int threads) {
+  SpaceInvaders **instances = malloc(count * sizeof(SpaceInvaders *));
+  StepBatch step = { .envs = envs, .actions = actions, .index = malloc(count * sizeof(int)) };
+  Batch batch = {
+    .instances = instances,
+    .before_frame = step_input,
+    .after_frame = step_running,
+    .context = &step,
+  };
+  // batch_run always runs a first frame, games already over are left out
+  for (int i = 0; i < count; i++) {
+    rewards[i] = si_get_score(envs[i]);
+    if (!si_game_over(envs[i])) {
+      step.index[batch.count] = i;
+      instances[batch.count++] = envs[i]->si;
+    }
+  }
+  if (batch.count > 0 && frames > 0) {
+    batch_run(&batch, threads > 0 ? threads : 1, frames);
+  }
+  for (int i = 0; i < count; i++) {
+    rewards[i] = points(rewards[i], si_get_score(envs[i]));
+  }
+  free(instances);
+  free(step.index);
+}
+
+const uint8_t *si_get_frame(SiEnv *env) {
+  return &env->si->memory.bytes[VRAM_ADDRESS];
+}
+
+const uint8_t *si_get_ram(SiEnv *env) {
+  return &env->si->memory.bytes[RAM_ADDRESS];
+}
+
+int si_get_score(SiEnv *env) {
+  const uint8_t *ram = env->si->memory.bytes;
+  return bcd(ram[P1_SCORE_ADDRESS + 1]) * 100 + bcd(ram[P1_SCORE_ADDRESS]);
+}
+
+int si_get_lives(SiEnv *env) {
+  return si_game_over(env) ? 0 : env->si->memory.bytes[P1_SHIPS_ADDRESS] + 1;
+}
+
+uint64_t si_get_frames(SiEnv *env) {
+  return env->si->frames;
+}
+
+size_t si_clone_state(SiEnv *env, void *buffer, size_t size) {
+  if (buffer != NULL && size >= env->state_size) {
+    savestate_save(env->si, buffer);
+  }
+  return env->state_size;
+}
+
+bool si_restore_state(SiEnv *env, const void *buffer, size_t size) {
+  return savestate_load(env->si, buffer, size);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SI_API_H
+#define SI_API_H
+
+// Stable C API of the libspaceinvaders_api shared library, for agent training
+// loops: a gym style environment of one player games, stepped in whole frames.
+// The header only depends on the C standard library and the environment is
+// opaque, so the emulator internals can change without breaking callers.
+// Environments are independent; one must not be used by two threads at once.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// SI_API_BUILD is only defined while building the library itself
+#if defined(_WIN32) && defined(SI_API_BUILD)
+#define SI_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define SI_API __declspec(dllimport)
+#else
+#define SI_API __attribute__((visibility("default")))
+#endif
+
+#define SI_API_VERSION 1
+
+// VRAM as returned by si_get_frame: 224 lines of 32 bytes, 1 bit per pixel.
+// The monitor is rotated, each line is a column of the upright 224x256
+// screen, bit 0 of its first byte at the bottom.
+#define SI_FRAME_LINES 224
+#define SI_FRAME_LINE_BYTES 32
+#define SI_FRAME_BYTES (SI_FRAME_LINES * SI_FRAME_LINE_BYTES)
+// RAM as returned by si_get_ram: 0x2000-0x3fff, the work RAM followed by
+// VRAM at offset 0x400
+#define SI_RAM_BYTES 0x2000
+
+// Actions, in the order of the Atari SpaceInvaders environments. Any other
+// value acts as SI_NOOP.
+enum SiAction {
+  SI_NOOP,
+  SI_FIRE,
+  SI_RIGHT,
+  SI_LEFT,
+  SI_RIGHT_FIRE,
+  SI_LEFT_FIRE,
+  SI_ACTION_COUNT,
+};
+
+typedef struct siEnv SiEnv;
+
+SI_API int si_api_version(void);
+// Loads INVADERS.H, .G, .F and .E from rom_directory, boots the game and
+// starts a one player game with lives ships (3 to 6, 0 for the default 3).
+// That start is the state si_reset returns to. NULL if a ROM file is missing
+// or does not fit; errors are only reported by the return values, the library
+// never prints.
+SI_API SiEnv *si_create(const char *rom_directory, int lives);
+SI_API void si_destroy(SiEnv *env);
+SI_API void si_reset(SiEnv *env);
+// Holds action for frames frames, stopping early on game over. Returns the
+// points scored meanwhile.
+SI_API int si_step(SiEnv *env, int action, int frames);
+// si_step on count environments at once, with actions[i] for envs[i] and the
+// points written to rewards[i], spread over threads worker threads
+SI_API void si_step_batch(SiEnv **envs, int count, const int *actions, int frames, int *rewards, int threads);
+SI_API bool si_game_over(SiEnv *env);
+// Zero-copy views of the machine, valid until si_destroy and updated by every
+// step
+SI_API const uint8_t *si_get_frame(SiEnv *env);
+SI_API const uint8_t *si_get_ram(SiEnv *env);
+// Player 1 score and ships left, the one in play included, decoded from RAM
+SI_API int si_get_score(SiEnv *env);
+SI_API int si_get_lives(SiEnv *env);
+SI_API uint64_t si_get_frames(SiEnv *env);
+// Writes the complete state of env to buffer (a save state, about 8 KB) and
+// returns its size. With a NULL buffer or one smaller than that, only returns
+// the size.
+SI_API size_t si_clone_state(SiEnv *env, void *buffer, size_t size);
+// Restores a state from si_clone_state, false if it is not one of this game
+SI_API bool si_restore_state(SiEnv *env, const void *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SI_API_H
@@ -5,18 +5,75 @@
 #ifndef SPACE_INVADERS_H
 #define SPACE_INVADERS_H
 
-#define MEMORY_BYTES (1 << 14)
+#define MEMORY_BYTES (1 << 16) // whole 8080 address space
+#define SPACE_INVADERS_MEMORY_BYTES (1 << 14)
+
+#define ROM_H_ADDRESS 0x0000
+#define ROM_G_ADDRESS 0x0800
+#define ROM_F_ADDRESS 0x1000
+#define ROM_E_ADDRESS 0x1800
+#define RAM_ADDRESS 0x2000
+#define VRAM_ADDRESS 0x2400
+#define VRAM_SIZE 0x1C00
+#define VRAM_LINE_BYTES 0x20
+#define VRAM_LINES (VRAM_SIZE / VRAM_LINE_BYTES)
+
+// VRAM changed since the screen was last drawn. Lines are the 32 byte VRAM
+// lines (screen columns), columns the byte offsets within a line (8 screen
+// rows each), so a dirty column is a contiguous stripe of the upright screen.
+typedef struct vramDirty {
+  uint32_t columns;                 // bitmask of columns with changes
+  uint8_t from[VRAM_LINE_BYTES];    // first changed line per column
+  uint8_t to[VRAM_LINE_BYTES];      // last changed line per column
+  uint8_t map[VRAM_SIZE / 8];       // changed bytes
+  uint32_t bytes;                   // distinct bytes changed
+  uint32_t writes;                  // VRAM writes, changing a byte or not
+} VramDirty;
 
 typedef struct memory {
-  uint8_t bytes[MEMORY_BYTES];
+  uint8_t *bytes;        // board, or an allocated map larger than it (CP/M)
+  uint16_t address_mask; // memory size - 1, addresses above wrap around
+  uint16_t rom_size;     // writes below it are ignored
+  uint32_t rom_hash;     // FNV-1a of the ROM, updated when it is (re)written
+  VramDirty vram_dirty;
+  uint8_t board[SPACE_INVADERS_MEMORY_BYTES];
 } Memory;
 
+void memory_init(Memory *memory, int size, int rom_size);
+void memory_free(Memory *memory);
 void memory_write(Memory *memory, uint8_t bytes[], int address, int size);
 void memory_peek(Memory *memory, int from, int to);
 void memory_peek_highlight(Memory *memory, int address, int size, int highlight);
 void memory_dump(Memory *memory);
 void memory_write_byte(Memory *memory, uint16_t address, uint8_t data);
 uint8_t memory_read_byte(Memory *memory, uint16_t address);
+void memory_clear_vram_dirty(Memory *memory);
+void memory_mark_vram_dirty(Memory *memory);
+void vram_write_byte(Memory *memory, uint16_t address, uint8_t data);
+void vram_dirty_merge(VramDirty *into, const VramDirty *from);
+
+static inline bool is_vram_address(uint16_t address) {
+  return (uint16_t) (address - VRAM_ADDRESS) < VRAM_SIZE;
+}
+
+// Unchecked accesses: the 16 bit address is masked into memory, so on the
+// Space Invaders board anything from 0x4000 up mirrors the first 16 KB, and
+// ROM writes are dropped. There is no bounds check or exit, the checked
+// memory_read_byte / memory_write_byte are the debug path.
+static inline uint8_t memory_read_byte_unchecked(Memory *memory, uint16_t address) {
+  return memory->bytes[address & memory->address_mask];
+}
+
+static inline void memory_write_byte_unchecked(Memory *memory, uint16_t address, uint8_t data) {
+  address &= memory->address_mask;
+  if (address < memory->rom_size) {
+    return;
+  }
+  if (is_vram_address(address)) {
+    vram_write_byte(memory, address, data);
+  }
+  memory->bytes[address] = data;
+}
 
 #define REGISTER_COUNT 8
 
@@ -55,14 +112,39 @@ typedef struct i8080 {
   uint16_t pc;
   uint16_t sp;
   bool interrupt_enabled;
+  bool interrupt_delay;     // EI takes effect after the next instruction
+  bool interrupt_requested; // INT line raised, held until acknowledged
+  uint8_t interrupt_vector; // RST number put on the bus on acknowledge
   bool stopped;
 } I8080;
 
+#define RST_OPCODE(n) (0xc7 | (n) << 3)
+
+// F register: SZ0A0P1C
+#define CARRY_FLAG_POS 0
+#define PARITY_FLAG_POS 2
+#define AUX_CARRY_FLAG_POS 4
+#define ZERO_FLAG_POS 6
+#define SIGN_FLAG_POS 7
+
+#define CARRY_FLAG (1 << CARRY_FLAG_POS)
+#define PARITY_FLAG (1 << PARITY_FLAG_POS)
+#define AUX_CARRY_FLAG (1 << AUX_CARRY_FLAG_POS)
+#define ZERO_FLAG (1 << ZERO_FLAG_POS)
+#define SIGN_FLAG (1 << SIGN_FLAG_POS)
+#define SZP_FLAGS (SIGN_FLAG | ZERO_FLAG | PARITY_FLAG)
+
+// Unused bits of F: POP PSW cannot change them, bit 1 always reads as 1
+#define FLAGS_UNUSED_MASK 0x2a
+#define FLAGS_FIXED_BITS 0x02
+
 uint8_t get_register(I8080 *cpu, enum Register r);
 void set_register(I8080 *cpu, enum Register r, uint8_t value);
 void copy_register(I8080 *cpu, enum Register dst, enum Register src);
 void increment_register(I8080 *cpu, enum Register r);
 void decrement_register(I8080 *cpu, enum Register r);
+uint8_t increment_byte(I8080 *cpu, uint8_t a);
+uint8_t decrement_byte(I8080 *cpu, uint8_t a);
 
 void add_accumulator(I8080 *cpu, uint8_t value);
 void add_with_carry_accumulator(I8080 *cpu, uint8_t value);
@@ -120,6 +202,9 @@ void stop(I8080 *cpu);
 bool is_stopped(I8080 *cpu);
 void enable_interrupt(I8080 *cpu);
 void disable_interrupt(I8080 *cpu);
+void request_interrupt(I8080 *cpu, uint8_t vector);
+int acknowledge_interrupt(I8080 *cpu);
+bool waiting_for_interrupt(I8080 *cpu);
 
 void print_state_8080(I8080 *cpu);
 
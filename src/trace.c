@@ -0,0 +1,163 @@
+#include "trace.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ports.h"
+
+static const char *trace_level_names[] = {
+  "off",
+  "instructions",
+  "bus",
+  "full",
+};
+
+bool trace_level_from_name(const char *name, enum TraceLevel *level) {
+  for (int i = TRACE_OFF; i <= TRACE_FULL; i++) {
+    if (strcmp(name, trace_level_names[i]) == 0) {
+      *level = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+void set_trace_level(Trace *trace, enum TraceLevel level) {
+  if (level > TRACE_LEVEL && level <= TRACE_FULL) {
+    printf(
+      "Warning: trace level '%s' not compiled in, using '%s' (rebuild with -DTRACE_LEVEL=%s)\n",
+      trace_level_names[level],
+      trace_level_names[TRACE_LEVEL],
+      trace_level_names[level]
+    );
+    level = TRACE_LEVEL;
+  }
+  trace->level = level;
+}
+
+void trace_next_bytes(uint8_t first, uint8_t second, uint8_t third) {
+  printf("%02x %02x %02x\n", first, second, third);
+}
+
+void trace_instruction(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  printf("\n····················\n");
+}
+
+void trace_bus(bool write, uint16_t address, uint8_t data) {
+  printf("~ %c %04x %02x\n", write ? 'w' : 'r', address, data);
+}
+
+void trace_output(uint8_t device, uint8_t data) {
+  printf("* A register value %02x sent to output device %02x -> ", data, device);
+  switch (device) {
+    case PORT_SHFTAMNT:
+      printf("SHFTAMNT");
+      break;
+    case PORT_SOUND1:
+      printf("SOUND1");
+      break;
+    case PORT_SHFT_DATA:
+      printf("SHFT_DATA");
+      break;
+    case PORT_SOUND2:
+      printf("SOUND2");
+      break;
+    case PORT_WATCHDOG:
+      printf("WATCHDOG");
+      break;
+    default:
+      printf("UNKNOWN INPUT");
+  }
+  printf("\n");
+}
+
+void trace_input(uint8_t device, uint8_t data) {
+  printf("* A register value set to %02x, received from input device %02x -> ", data, device);
+  switch (device) {
+    case PORT_INP0:
+    case PORT_INP1:
+    case PORT_INP2:
+      printf("INP%d", device);
+      break;
+    case PORT_SHFT_IN:
+      printf("SHFT_IN");
+      break;
+    default:
+      printf("UNKNOWN INPUT");
+  }
+  printf("\n");
+}
+
+void trace_interrupt(uint8_t opcode) {
+  printf("* interrupt acknowledged, executing %02x instead of the next instruction\n", opcode);
+}
+
+void trace_state(I8080 *cpu, Memory *memory) {
+  print_state_8080(cpu);
+  printf("····················\n");
+  memory_peek_highlight(memory, trace_stack_line(cpu->sp), 0x10, cpu->sp);
+  printf("~~~~~~~~~~~~~~~~~~~~\n");
+}
+
+// Recorder to flush when the process exits through exit(), e.g. a failed bounds check
+static TraceRecorder *exit_recorder;
+
+static void trace_recorder_close_at_exit(void) {
+  if (exit_recorder != NULL) {
+    trace_recorder_close(exit_recorder);
+  }
+}
+
+TraceRecorder *trace_recorder_open(char *filename, bool ring) {
+  FILE *f = fopen(filename, "wb");
+  if (f == NULL) {
+    printf("Error: unable to open trace file %s\n", filename);
+    exit(1);
+  }
+
+  TraceFileHeader header = { TRACE_FILE_MAGIC, TRACE_FILE_VERSION, sizeof(TraceRecord) };
+  fwrite(&header, sizeof(header), 1, f);
+
+  TraceRecorder *recorder = calloc(1, sizeof(TraceRecorder));
+  recorder->ring = ring;
+  recorder->file = f;
+
+  if (exit_recorder == NULL) {
+    exit_recorder = recorder;
+    atexit(trace_recorder_close_at_exit);
+  }
+  return recorder;
+}
+
+// Writes the buffered records oldest first and empties the buffer
+void trace_recorder_flush(TraceRecorder *recorder) {
+  uint32_t oldest = recorder->count == TRACE_BUFFER_RECORDS ? recorder->head : 0;
+  uint32_t first_block = TRACE_BUFFER_RECORDS - oldest;
+  if (first_block > recorder->count) {
+    first_block = recorder->count;
+  }
+  fwrite(recorder->records + oldest, sizeof(TraceRecord), first_block, recorder->file);
+  fwrite(recorder->records, sizeof(TraceRecord), recorder->count - first_block, recorder->file);
+  recorder->count = 0;
+}
+
+void trace_recorder_close(TraceRecorder *recorder) {
+  if (exit_recorder == recorder) {
+    exit_recorder = NULL;
+  }
+  trace_recorder_flush(recorder);
+  fclose(recorder->file);
+  printf("%llu instructions traced", (unsigned long long) recorder->total);
+  if (recorder->ring && recorder->total > TRACE_BUFFER_RECORDS) {
+    printf(", last %d kept", TRACE_BUFFER_RECORDS);
+  }
+  printf("\n");
+  free(recorder);
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "space_invaders.h"
+
+#ifndef TRACE_H
+#define TRACE_H
+
+// Highest trace level compiled in, set from the TRACE_LEVEL CMake option.
+// Anything above it is constant folded away, so a TRACE_LEVEL=0 build carries
+// no tracing code at all in the cycle() hot loop.
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 0
+#endif
+
+enum TraceLevel {
+  TRACE_OFF = 0,
+  TRACE_INSTRUCTIONS = 1, // decoded instructions and I/O
+  TRACE_BUS = 2,          // + memory reads / writes
+  TRACE_FULL = 3,         // + next bytes, CPU state and stack after every instruction
+};
+
+// Binary trace: one fixed-size record per instruction, holding everything the
+// text trace prints so trace_decode can render it back offline. Records are
+// stored in host byte order.
+#define TRACE_FILE_MAGIC "I8080TRC"
+#define TRACE_FILE_VERSION 1
+#define TRACE_BUS_EVENTS 6
+#define TRACE_STACK_BYTES 16
+#define TRACE_NO_MNEMONIC 0xff
+#define TRACE_INTERRUPT_ENABLED 1
+#define TRACE_STOPPED 2
+#define TRACE_BUFFER_RECORDS 4096 // 256 KB, also the block size written to disk
+
+typedef struct traceBusEvent {
+  uint16_t address;
+  uint8_t data;
+  uint8_t write;
+} TraceBusEvent;
+
+typedef struct traceRecord {
+  uint16_t pc;                           // address of the opcode
+  uint8_t bytes[3];                      // opcode and operands
+  uint8_t bus_count;
+  uint8_t mnemonic_at;                   // bus events traced before the mnemonic
+  uint8_t flags;                         // TRACE_INTERRUPT_ENABLED | TRACE_STOPPED
+  TraceBusEvent bus[TRACE_BUS_EVENTS];
+  uint8_t registers[REGISTER_COUNT];     // state after the instruction
+  uint16_t next_pc;
+  uint16_t sp;
+  uint8_t stack[TRACE_STACK_BYTES];      // stack line around SP
+  uint8_t interrupt;                     // RST opcode executed for an interrupt, 0 otherwise
+  uint8_t reserved[3];
+} TraceRecord;
+
+_Static_assert(sizeof(TraceRecord) == 64, "trace records are fixed size");
+
+typedef struct traceFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+} TraceFileHeader;
+
+typedef struct traceRecorder {
+  TraceRecord records[TRACE_BUFFER_RECORDS];
+  uint32_t head;   // record being filled
+  uint32_t count;  // completed records held in the buffer
+  uint64_t total;  // completed records since open
+  bool ring;       // keep only the latest records, written on close
+  FILE *file;
+} TraceRecorder;
+
+typedef struct trace {
+  enum TraceLevel level;   // runtime level, capped by TRACE_LEVEL
+  TraceRecorder *recorder; // binary trace, NULL when not recording
+} Trace;
+
+#define tracing(trace, lvl) (TRACE_LEVEL >= (lvl) && (trace)->level >= (lvl))
+#define recording(trace) (TRACE_LEVEL > TRACE_OFF && (trace)->recorder != NULL)
+
+bool trace_level_from_name(const char *name, enum TraceLevel *level);
+void set_trace_level(Trace *trace, enum TraceLevel level);
+
+void trace_next_bytes(uint8_t first, uint8_t second, uint8_t third);
+void trace_instruction(const char *format, ...);
+void trace_bus(bool write, uint16_t address, uint8_t data);
+void trace_output(uint8_t device, uint8_t data);
+void trace_input(uint8_t device, uint8_t data);
+void trace_interrupt(uint8_t opcode);
+void trace_state(I8080 *cpu, Memory *memory);
+
+// First address of the 16 byte line printed around SP
+static inline uint16_t trace_stack_line(uint16_t sp) {
+  uint16_t line_start = sp & 0xfff0;
+  if (sp % 0x10 == 0) {
+    line_start -= 0x10;
+  }
+  return line_start;
+}
+
+TraceRecorder *trace_recorder_open(char *filename, bool ring);
+void trace_recorder_close(TraceRecorder *recorder);
+void trace_recorder_flush(TraceRecorder *recorder);
+
+static inline void trace_record_begin(TraceRecorder *recorder, uint16_t pc, Memory *memory) {
+  TraceRecord *record = &recorder->records[recorder->head];
+  record->pc = pc;
+  for (int i = 0; i < 3; i++) {
+    uint16_t address = pc + i;
+    record->bytes[i] = address <= memory->address_mask ? memory->bytes[address] : 0;
+  }
+  record->bus_count = 0;
+  record->mnemonic_at = TRACE_NO_MNEMONIC;
+  record->interrupt = 0;
+}
+
+static inline void trace_record_interrupt(TraceRecorder *recorder, uint8_t opcode) {
+  recorder->records[recorder->head].interrupt = opcode;
+}
+
+static inline void trace_record_bus(TraceRecorder *recorder, bool write, uint16_t address, uint8_t data) {
+  TraceRecord *record = &recorder->records[recorder->head];
+  if (record->bus_count < TRACE_BUS_EVENTS) {
+    record->bus[record->bus_count++] = (TraceBusEvent) { address, data, write };
+  }
+}
+
+static inline void trace_record_instruction(TraceRecorder *recorder) {
+  TraceRecord *record = &recorder->records[recorder->head];
+  record->mnemonic_at = record->bus_count;
+}
+
+static inline void trace_record_end(TraceRecorder *recorder, I8080 *cpu, Memory *memory) {
+  TraceRecord *record = &recorder->records[recorder->head];
+  memcpy(record->registers, cpu->registers, REGISTER_COUNT);
+  record->next_pc = cpu->pc;
+  record->sp = cpu->sp;
+  record->flags = (cpu->interrupt_enabled ? TRACE_INTERRUPT_ENABLED : 0) | (cpu->stopped ? TRACE_STOPPED : 0);
+  uint16_t line_start = trace_stack_line(cpu->sp);
+  if (line_start + TRACE_STACK_BYTES <= memory->address_mask + 1) {
+    memcpy(record->stack, memory->bytes + line_start, TRACE_STACK_BYTES);
+  } else {
+    memset(record->stack, 0, TRACE_STACK_BYTES);
+  }
+
+  recorder->total++;
+  if (recorder->count < TRACE_BUFFER_RECORDS) {
+    recorder->count++;
+  }
+  if (++recorder->head == TRACE_BUFFER_RECORDS) {
+    recorder->head = 0;
+    if (!recorder->ring) {
+      trace_recorder_flush(recorder);
+    }
+  }
+}
+
+#endif //TRACE_H
@@ -0,0 +1,36 @@
+#include "triple_buffer.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+void triple_buffer_init(TripleBuffer *buffer) {
+  buffer->back = 0;
+  buffer->front = 1;
+  atomic_init(&buffer->shared, 2);
+}
+
+FrameSlot *triple_buffer_back(TripleBuffer *buffer) {
+  return &buffer->slots[buffer->back];
+}
+
+FrameSlot *triple_buffer_untaken(TripleBuffer *buffer) {
+  int shared = atomic_load_explicit(&buffer->shared, memory_order_acquire);
+  if (!(shared & TRIPLE_BUFFER_FRESH)) {
+    return NULL;
+  }
+  return &buffer->slots[shared & ~TRIPLE_BUFFER_FRESH];
+}
+
+void triple_buffer_publish(TripleBuffer *buffer) {
+  int shared = atomic_exchange_explicit(&buffer->shared, buffer->back | TRIPLE_BUFFER_FRESH, memory_order_acq_rel);
+  buffer->back = shared & ~TRIPLE_BUFFER_FRESH;
+}
+
+FrameSlot *triple_buffer_take(TripleBuffer *buffer) {
+  if (!(atomic_load_explicit(&buffer->shared, memory_order_relaxed) & TRIPLE_BUFFER_FRESH)) {
+    return NULL;
+  }
+  int shared = atomic_exchange_explicit(&buffer->shared, buffer->front, memory_order_acq_rel);
+  buffer->front = shared & ~TRIPLE_BUFFER_FRESH;
+  return &buffer->slots[buffer->front];
+}
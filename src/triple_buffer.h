@@ -0,0 +1,39 @@
+#pragma once
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "space_invaders.h"
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+// A completed frame as handed from the emulation thread to the frontend
+typedef struct frameSlot {
+  uint8_t vram[VRAM_SIZE];
+  VramDirty dirty; // VRAM changes since the frame the frontend last took
+  uint64_t frames; // emulated frames when published
+} FrameSlot;
+
+// Lock-free triple buffer: the emulation fills the back slot and swaps it
+// with the shared one, the frontend swaps the shared slot with its front one
+// when a newer frame is there. Neither side waits and each owns its slot
+// exclusively between swaps.
+#define TRIPLE_BUFFER_FRESH 4 // on the shared index: published, not taken yet
+
+typedef struct tripleBuffer {
+  FrameSlot slots[3];
+  int back;           // owned by the producer
+  int front;          // owned by the consumer
+  _Atomic int shared; // slot index | TRIPLE_BUFFER_FRESH
+} TripleBuffer;
+
+void triple_buffer_init(TripleBuffer *buffer);
+FrameSlot *triple_buffer_back(TripleBuffer *buffer);
+// Last published frame if the consumer has not taken it yet, else NULL.
+// The producer may read it but the consumer can take it at any time.
+FrameSlot *triple_buffer_untaken(TripleBuffer *buffer);
+void triple_buffer_publish(TripleBuffer *buffer);
+// Newest published frame, or NULL if there is none since the last take
+FrameSlot *triple_buffer_take(TripleBuffer *buffer);
+
+#endif //TRIPLE_BUFFER_H
@@ -0,0 +1,199 @@
+#include "video.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VIDEO_X86
+#include <immintrin.h>
+#endif
+
+// All kernels walk the 32 VRAM byte columns: a column feeds 8 consecutive
+// output rows, one per bit, so its bytes are gathered once into a contiguous
+// line and then expanded row by row with sequential writes. A kernel expands
+// pixels [from, to) of a row, both multiples of EXPAND_ALIGN.
+#define EXPAND_ALIGN 32
+
+typedef void (*ExpandRow)(const uint8_t *line, uint8_t bit, uint32_t foreground, uint32_t background, uint32_t *row, int from, int to);
+
+static void expand_row_scalar(const uint8_t *line, uint8_t bit, uint32_t foreground, uint32_t background, uint32_t *row, int from, int to) {
+  for (int x = from; x < to; x++) {
+    row[x] = line[x] & bit ? foreground : background;
+  }
+}
+
+#ifdef VIDEO_X86
+__attribute__((target("sse2")))
+static void expand_row_sse2(const uint8_t *line, uint8_t bit, uint32_t foreground, uint32_t background, uint32_t *row, int from, int to) {
+  const __m128i mask = _mm_set1_epi8((char) bit);
+  const __m128i fg = _mm_set1_epi32((int) foreground);
+  const __m128i bg = _mm_set1_epi32((int) background);
+  for (int x = from; x < to; x += 16) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *) (line + x));
+    __m128i lit = _mm_cmpeq_epi8(_mm_and_si128(bytes, mask), mask);
+    // widen the 16 byte masks to 16 pixel masks
+    __m128i lo = _mm_unpacklo_epi8(lit, lit);
+    __m128i hi = _mm_unpackhi_epi8(lit, lit);
+    __m128i lit32[4] = {
+      _mm_unpacklo_epi16(lo, lo),
+      _mm_unpackhi_epi16(lo, lo),
+      _mm_unpacklo_epi16(hi, hi),
+      _mm_unpackhi_epi16(hi, hi),
+    };
+    for (int i = 0; i < 4; i++) {
+      __m128i pixels = _mm_or_si128(_mm_and_si128(lit32[i], fg), _mm_andnot_si128(lit32[i], bg));
+      _mm_storeu_si128((__m128i *) (row + x + i * 4), pixels);
+    }
+  }
+}
+
+__attribute__((target("avx2")))
+static void expand_row_avx2(const uint8_t *line, uint8_t bit, uint32_t foreground, uint32_t background, uint32_t *row, int from, int to) {
+  const __m256i mask = _mm256_set1_epi8((char) bit);
+  const __m256i fg = _mm256_set1_epi32((int) foreground);
+  const __m256i bg = _mm256_set1_epi32((int) background);
+  for (int x = from; x < to; x += 32) {
+    __m256i bytes = _mm256_loadu_si256((const __m256i *) (line + x));
+    __m256i lit = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, mask), mask);
+    __m128i halves[2] = { _mm256_castsi256_si128(lit), _mm256_extracti128_si256(lit, 1) };
+    for (int i = 0; i < 4; i++) {
+      // sign extension turns each 0xff byte mask into a 0xffffffff pixel mask
+      __m128i eight = i % 2 ? _mm_srli_si128(halves[i / 2], 8) : halves[i / 2];
+      __m256i lit32 = _mm256_cvtepi8_epi32(eight);
+      __m256i pixels = _mm256_blendv_epi8(bg, fg, lit32);
+      _mm256_storeu_si256((__m256i *) (row + x + i * 8), pixels);
+    }
+  }
+}
+#endif
+
+static ExpandRow expand_row(enum VideoKernel kernel) {
+  switch (kernel) {
+#ifdef VIDEO_X86
+    case VIDEO_SSE2:
+      return expand_row_sse2;
+    case VIDEO_AVX2:
+      return expand_row_avx2;
+#endif
+    default:
+      return expand_row_scalar;
+  }
+}
+
+bool video_kernel_supported(enum VideoKernel kernel) {
+  switch (kernel) {
+    case VIDEO_SCALAR:
+      return true;
+#ifdef VIDEO_X86
+    case VIDEO_SSE2:
+      return __builtin_cpu_supports("sse2");
+    case VIDEO_AVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+const char *video_kernel_name(enum VideoKernel kernel) {
+  static const char *names[] = { "scalar", "sse2", "avx2" };
+  return names[kernel];
+}
+
+void video_init(Video *video, uint32_t foreground, uint32_t background) {
+  for (int y = 0; y < SCREEN_HEIGHT; y++) {
+    video->foreground[y] = foreground;
+  }
+  video->background = background;
+  for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+    video->pixels[i] = background;
+  }
+
+  video->kernel = VIDEO_SCALAR;
+  for (enum VideoKernel kernel = VIDEO_SSE2; kernel <= VIDEO_AVX2; kernel++) {
+    if (video_kernel_supported(kernel)) {
+      video->kernel = kernel;
+    }
+  }
+}
+
+void video_set_overlay(Video *video, uint32_t white, uint32_t red, uint32_t green) {
+  for (int y = 0; y < SCREEN_HEIGHT; y++) {
+    if (y >= OVERLAY_RED_FROM && y <= OVERLAY_RED_TO) {
+      video->foreground[y] = red;
+    } else if (y >= OVERLAY_GREEN_FROM && y <= OVERLAY_GREEN_TO) {
+      video->foreground[y] = green;
+    } else {
+      video->foreground[y] = white;
+    }
+  }
+}
+
+// Expands VRAM lines [from, to) of one byte column into its 8 output rows
+static void expand_column(Video *video, ExpandRow expand, const uint8_t *vram, int column, int from, int to) {
+  uint8_t line[SCREEN_WIDTH];
+  for (int x = from; x < to; x++) {
+    line[x] = vram[x * VRAM_LINE_BYTES + column];
+  }
+  for (int i = 0; i < 8; i++) {
+    const int y = SCREEN_HEIGHT - 1 - (column * 8 + i);
+    expand(line, 1 << i, video->foreground[y], video->background, video->pixels + y * SCREEN_WIDTH, from, to);
+  }
+}
+
+void video_expand(Video *video, const uint8_t *vram) {
+  ExpandRow expand = expand_row(video->kernel);
+  for (int column = 0; column < VRAM_LINE_BYTES; column++) {
+    expand_column(video, expand, vram, column, 0, SCREEN_WIDTH);
+  }
+}
+
+bool video_expand_dirty(Video *video, const uint8_t *vram, VramDirty *dirty, int *row_from, int *row_to) {
+  if (dirty->columns == 0) {
+    return false;
+  }
+
+  ExpandRow expand = expand_row(video->kernel);
+  int first = -1;
+  int last = 0;
+  for (int column = 0; column < VRAM_LINE_BYTES; column++) {
+    if (!(dirty->columns >> column & 1)) {
+      continue;
+    }
+    int from = dirty->from[column] / EXPAND_ALIGN * EXPAND_ALIGN;
+    int to = (dirty->to[column] / EXPAND_ALIGN + 1) * EXPAND_ALIGN;
+    expand_column(video, expand, vram, column, from, to);
+    if (first < 0) {
+      first = column;
+    }
+    last = column;
+  }
+
+  // higher columns are higher up the screen
+  *row_from = SCREEN_HEIGHT - (last + 1) * 8;
+  *row_to = SCREEN_HEIGHT - 1 - first * 8;
+  return true;
+}
+
+// Writes the upright screen as a binary PBM, lit pixels black
+void video_write_pbm(const uint8_t *vram, const char *filename) {
+  FILE *f = fopen(filename, "wb");
+  if (f == NULL) {
+    printf("Error: unable to open %s\n", filename);
+    exit(1);
+  }
+  fprintf(f, "P4\n%d %d\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+  for (int y = 0; y < SCREEN_HEIGHT; y++) {
+    int column = (SCREEN_HEIGHT - 1 - y) / 8;
+    uint8_t bit = 1 << (SCREEN_HEIGHT - 1 - y) % 8;
+    uint8_t row[SCREEN_WIDTH / 8] = { 0 };
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+      if (vram[x * VRAM_LINE_BYTES + column] & bit) {
+        row[x / 8] |= 0x80 >> x % 8;
+      }
+    }
+    fwrite(row, sizeof(row), 1, f);
+  }
+  fclose(f);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "space_invaders.h"
+
+#ifndef VIDEO_H
+#define VIDEO_H
+
+// The monitor is mounted rotated 90° counterclockwise: each 32 byte VRAM line
+// is a column of the upright screen, bit 0 of its first byte at the bottom.
+#define SCREEN_WIDTH 224
+#define SCREEN_HEIGHT 256
+
+// Color bands of the cabinet's cellophane overlay, in upright screen rows
+#define OVERLAY_RED_FROM 32
+#define OVERLAY_RED_TO 63
+#define OVERLAY_GREEN_FROM 184
+#define OVERLAY_GREEN_TO 239
+
+enum VideoKernel {
+  VIDEO_SCALAR,
+  VIDEO_SSE2,
+  VIDEO_AVX2,
+};
+
+typedef struct video {
+  uint32_t pixels[SCREEN_WIDTH * SCREEN_HEIGHT]; // upright, RGBA8 in memory order
+  uint32_t foreground[SCREEN_HEIGHT];            // lit pixel color per row
+  uint32_t background;
+  enum VideoKernel kernel;
+} Video;
+
+// Picks the fastest kernel the host supports
+void video_init(Video *video, uint32_t foreground, uint32_t background);
+void video_set_overlay(Video *video, uint32_t white, uint32_t red, uint32_t green);
+bool video_kernel_supported(enum VideoKernel kernel);
+const char *video_kernel_name(enum VideoKernel kernel);
+void video_expand(Video *video, const uint8_t *vram);
+// Expands only what changed since the dirty state was cleared. Returns false
+// when nothing did, otherwise the range of rows to upload.
+bool video_expand_dirty(Video *video, const uint8_t *vram, VramDirty *dirty, int *row_from, int *row_to);
+void video_write_pbm(const uint8_t *vram, const char *filename);
+
+#endif //VIDEO_H
@@ -0,0 +1,120 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opcodes.h"
+#include "space_invaders.h"
+#include "trace.h"
+
+// Renders a binary trace written with --trace-file in the text trace format
+// of the same level, e.g. trace_decode -t bus trace.bin
+
+void print_bus_events(TraceRecord *record, int from, int to) {
+  for (int i = from; i < to; i++) {
+    trace_bus(record->bus[i].write, record->bus[i].address, record->bus[i].data);
+  }
+}
+
+void print_record(TraceRecord *record, enum TraceLevel level, Memory *memory) {
+  if (level >= TRACE_FULL) {
+    trace_next_bytes(record->bytes[0], record->bytes[1], record->bytes[2]);
+  }
+
+  // an interrupt runs an RST opcode that is not in memory
+  uint8_t interrupt_bytes[3] = { record->interrupt, 0, 0 };
+  uint8_t *bytes = record->interrupt ? interrupt_bytes : record->bytes;
+  if (record->interrupt) {
+    trace_interrupt(record->interrupt);
+  }
+
+  int mnemonic_at = record->mnemonic_at == TRACE_NO_MNEMONIC ? record->bus_count : record->mnemonic_at;
+  if (level >= TRACE_BUS) {
+    print_bus_events(record, 0, mnemonic_at);
+  }
+  if (record->mnemonic_at != TRACE_NO_MNEMONIC) {
+    char mnemonic[32];
+    disassemble(mnemonic, sizeof(mnemonic), bytes);
+    trace_instruction("%s", mnemonic);
+  }
+  switch (bytes[0]) {
+    case 0xd3:
+      trace_output(record->bytes[1], record->registers[A]);
+      break;
+    case 0xdb:
+      trace_input(record->bytes[1], record->registers[A]);
+      break;
+  }
+  if (level >= TRACE_BUS) {
+    print_bus_events(record, mnemonic_at, record->bus_count);
+  }
+
+  if (level >= TRACE_FULL) {
+    I8080 cpu = {
+      .pc = record->next_pc,
+      .sp = record->sp,
+      .interrupt_enabled = record->flags & TRACE_INTERRUPT_ENABLED,
+      .stopped = record->flags & TRACE_STOPPED,
+    };
+    memcpy(cpu.registers, record->registers, REGISTER_COUNT);
+    uint16_t line_start = trace_stack_line(record->sp);
+    if (line_start + TRACE_STACK_BYTES <= MEMORY_BYTES) {
+      memcpy(memory->bytes + line_start, record->stack, TRACE_STACK_BYTES);
+    }
+    trace_state(&cpu, memory);
+  }
+}
+
+void usage(char *program) {
+  printf("Usage: %s [-t|--trace instructions|bus|full] file\n", program);
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  enum TraceLevel level = TRACE_FULL;
+  char *filename = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--trace") == 0) {
+      if (i + 1 == argc || !trace_level_from_name(argv[++i], &level)) {
+        usage(argv[0]);
+      }
+    } else if (filename == NULL) {
+      filename = argv[i];
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (filename == NULL) {
+    usage(argv[0]);
+  }
+
+  FILE *f = fopen(filename, "rb");
+  if (f == NULL) {
+    printf("Error: unable to open trace file %s\n", filename);
+    exit(1);
+  }
+
+  TraceFileHeader header;
+  if (fread(&header, sizeof(header), 1, f) != 1
+      || memcmp(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic)) != 0
+      || header.version != TRACE_FILE_VERSION
+      || header.record_size != sizeof(TraceRecord)) {
+    printf("Error: %s is not a version %d trace file\n", filename, TRACE_FILE_VERSION);
+    exit(1);
+  }
+
+  static Memory memory;
+  memory_init(&memory, MEMORY_BYTES, 0);
+  static TraceRecord records[TRACE_BUFFER_RECORDS];
+  size_t count;
+  while ((count = fread(records, sizeof(TraceRecord), TRACE_BUFFER_RECORDS, f)) > 0) {
+    for (size_t i = 0; i < count; i++) {
+      print_record(&records[i], level, &memory);
+    }
+  }
+  fclose(f);
+
+  return 0;
+}